@@ -0,0 +1,236 @@
+#ifndef __ARENA_HPP__
+#define __ARENA_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace simly {
+
+// Linear allocator over a list of heap blocks. reset() rewinds to the first
+// block but keeps the memory, merging overflow blocks into one, so a reused
+// arena stops touching the heap once it has grown to its working size.
+// Destructors are never run; only trivially destructible types may be
+// created in it.
+class Arena {
+  private:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data = {};
+        size_t size                     = {};
+    };
+
+    std::vector<Block> blocks;
+    size_t block_index = 0;
+    size_t offset      = 0;
+    size_t block_size  = 0;
+    size_t skipped     = 0; // bytes in blocks before block_index
+    size_t high_water  = 0;
+
+    void note_usage() { high_water = std::max(high_water, used()); }
+
+    static uintptr_t align_up(uintptr_t v, size_t align) {
+        return (v + (align - 1)) & ~uintptr_t(align - 1);
+    }
+
+  public:
+    explicit Arena(size_t default_block_size = 64 * 1024)
+        : block_size(default_block_size) {}
+
+    Arena(Arena &&)            = default;
+    Arena &operator=(Arena &&) = default;
+
+    void *allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+        assert(align != 0 && (align & (align - 1)) == 0 &&
+               "Alignment must be a power of two");
+        while (block_index < blocks.size()) {
+            Block &b        = blocks[block_index];
+            uintptr_t base  = uintptr_t(b.data.get());
+            uintptr_t start = align_up(base + offset, align);
+            if (start + size <= base + b.size) {
+                offset = size_t(start + size - base);
+                note_usage();
+                return reinterpret_cast<void *>(start);
+            }
+            skipped += b.size;
+            block_index++;
+            offset = 0;
+        }
+        Block b;
+        b.size = std::max(block_size, size + align);
+        b.data.reset(new uint8_t[b.size]);
+        blocks.push_back(std::move(b));
+        block_index     = blocks.size() - 1;
+        uintptr_t base  = uintptr_t(blocks.back().data.get());
+        uintptr_t start = align_up(base, align);
+        offset          = size_t(start + size - base);
+        note_usage();
+        return reinterpret_cast<void *>(start);
+    }
+
+    template <typename T> T *allocate_array(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "Arena memory is never destructed");
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    template <typename T, typename... Args> T *create(Args &&...args) {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "Arena memory is never destructed");
+        return new (allocate(sizeof(T), alignof(T)))
+            T(std::forward<Args>(args)...);
+    }
+
+    // Releases all allocations at once. If the last cycle spilled into
+    // several blocks they are replaced by one block of the combined size,
+    // so steady-state cycles run out of a single contiguous block.
+    void reset() {
+        if (blocks.size() > 1) {
+            Block merged;
+            merged.size = capacity();
+            merged.data.reset(new uint8_t[merged.size]);
+            blocks.clear();
+            blocks.push_back(std::move(merged));
+        }
+        block_index = 0;
+        offset      = 0;
+        skipped     = 0;
+    }
+
+    size_t used() const { return skipped + offset; }
+
+    // Largest used() seen since construction or the last reset_high_water().
+    size_t get_high_water() const { return high_water; }
+
+    void reset_high_water() { high_water = used(); }
+
+    size_t capacity() const {
+        size_t total = 0;
+        for (const Block &b : blocks)
+            total += b.size;
+        return total;
+    }
+};
+
+// STL allocator drawing from an Arena. deallocate() is a no-op; memory
+// comes back when the arena is reset, so containers using it must not
+// outlive that reset.
+template <typename T> class ArenaAllocator {
+  public:
+    using value_type = T;
+
+    Arena *arena = {};
+
+    explicit ArenaAllocator(Arena &a) : arena(&a) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+    T *allocate(size_t n) {
+        return static_cast<T *>(arena->allocate(sizeof(T) * n, alignof(T)));
+    }
+
+    void deallocate(T *, size_t) {}
+
+    template <typename U> bool operator==(const ArenaAllocator<U> &o) const {
+        return arena == o.arena;
+    }
+
+    template <typename U> bool operator!=(const ArenaAllocator<U> &o) const {
+        return arena != o.arena;
+    }
+};
+
+template <typename T> using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+// Per-thread arenas for transient per-tick data (neighbor lists, event
+// buffers, temporary columns). Each thread lazily gets its own arena on
+// first use, so allocation never synchronizes. reset_all() must be called
+// at the end of a tick while no other thread is allocating.
+class FrameArena {
+  private:
+    struct Registry {
+        std::mutex mutex;
+        std::vector<Arena *> arenas;
+        size_t block_size = 256 * 1024;
+    };
+
+    static Registry &registry() {
+        static Registry r;
+        return r;
+    }
+
+    struct Slot {
+        Arena arena;
+
+        Slot() : arena(registry().block_size) {
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.arenas.push_back(&arena);
+        }
+
+        ~Slot() {
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.arenas.erase(std::find(r.arenas.begin(), r.arenas.end(), &arena));
+        }
+    };
+
+  public:
+    // Block size for arenas of threads that have not allocated yet.
+    static void set_block_size(size_t size) {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.block_size = size;
+    }
+
+    static Arena &current() {
+        static thread_local Slot slot;
+        return slot.arena;
+    }
+
+    static void reset_all() {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        for (Arena *a : r.arenas)
+            a->reset();
+    }
+
+    // Highest peak usage of any single thread, in bytes.
+    static size_t high_water_max() {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        size_t peak = 0;
+        for (Arena *a : r.arenas)
+            peak = std::max(peak, a->get_high_water());
+        return peak;
+    }
+
+    // Sum of per-thread peaks; an upper bound on transient memory per tick.
+    static size_t high_water_total() {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        size_t total = 0;
+        for (Arena *a : r.arenas)
+            total += a->get_high_water();
+        return total;
+    }
+};
+
+// Vector whose storage lives in the calling thread's frame arena.
+template <typename T> ArenaVector<T> make_frame_vector(size_t reserve = 0) {
+    ArenaVector<T> v{ArenaAllocator<T>(FrameArena::current())};
+    if (reserve)
+        v.reserve(reserve);
+    return v;
+}
+
+} // namespace simly
+
+#endif // __ARENA_HPP__
@@ -0,0 +1,95 @@
+#ifndef __BATCH_HPP__
+#define __BATCH_HPP__
+
+#include <cassert>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "arena.hpp"
+#include "parallel.hpp"
+
+namespace simly {
+
+// Runs many small, independent simulation instances inside one process.
+// Every instance reads the same immutable Program (e.g. a compiled DSL
+// script) and gets a private Arena for its own state. Instances are spread
+// over the pool one whole instance per chunk; parallel code called from an
+// instance runs inline on its worker, so each core packs many instances
+// back to back instead of splitting each one thinly.
+template <typename Program, typename Config, typename Result>
+class BatchRunner {
+  public:
+    using RunFunc =
+        std::function<Result(const Program &, const Config &, Arena &)>;
+
+  private:
+    std::shared_ptr<const Program> program;
+    ThreadPool &pool;
+    std::vector<Arena> arenas;
+
+  public:
+    BatchRunner(std::shared_ptr<const Program> program,
+                ThreadPool &pool        = default_pool(),
+                size_t arena_block_size = 64 * 1024)
+        : program(std::move(program)), pool(pool) {
+        assert(this->program && "BatchRunner needs a program");
+        for (unsigned i = 0; i < pool.size(); i++)
+            arenas.emplace_back(arena_block_size);
+    }
+
+    // Results come back in the order of `configs`, independent of how the
+    // instances were scheduled. Arenas are reset between instances and
+    // keep their blocks, so memory is bounded by the largest instance per
+    // worker rather than by the size of the sweep.
+    std::vector<Result> run(const std::vector<Config> &configs,
+                            const RunFunc &fn) {
+        std::vector<Result> results(configs.size());
+        pool.parallel_for(configs.size(), 1,
+                          [&](size_t begin, size_t end, unsigned worker) {
+                              Arena &arena = arenas[worker];
+                              for (size_t i = begin; i < end; i++) {
+                                  arena.reset();
+                                  results[i] = fn(*program, configs[i], arena);
+                              }
+                          });
+        return results;
+    }
+
+    const Program &get_program() const { return *program; }
+
+    // Largest amount of arena memory held by any worker.
+    size_t peak_arena_capacity() const {
+        size_t peak = 0;
+        for (const Arena &a : arenas)
+            peak = std::max(peak, a.capacity());
+        return peak;
+    }
+};
+
+// Aggregates batch results into a single CSV file, one row per instance in
+// config order. row(result, stream) writes the row without the newline.
+template <typename Result, typename RowFunc>
+bool write_results_csv(const std::string &path, const std::string &header,
+                       const std::vector<Result> &results, const RowFunc &row) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: cannot open " << path << " for writing"
+                  << std::endl;
+        return false;
+    }
+    out << "instance," << header << "\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        out << i << ",";
+        row(results[i], out);
+        out << "\n";
+    }
+    return bool(out);
+}
+
+} // namespace simly
+
+#endif // __BATCH_HPP__
@@ -0,0 +1,179 @@
+#ifndef __DERIVED_HPP__
+#define __DERIVED_HPP__
+
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "dsl.hpp"
+
+namespace simly {
+
+using QuantityId = uint32_t;
+
+static const QuantityId InvalidQuantity = ~QuantityId(0);
+
+// Pull-based dependency graph for derived simulation quantities.
+//
+// Inputs are state the engine writes every tick; it calls invalidate() on
+// them after writing. Dirtiness is pushed eagerly to every transitive
+// dependent, but nothing is recomputed until require() is called on a
+// quantity, e.g. by an open UI panel or an output writer. A clean node
+// therefore always has clean inputs, and quantities nobody reads cost only
+// a flag write per tick.
+class DerivedGraph {
+  private:
+    struct Node {
+        std::string name                   = {};
+        std::function<void()> compute      = {};
+        std::vector<QuantityId> inputs     = {};
+        std::vector<QuantityId> dependents = {};
+        bool dirty                         = true;
+        uint64_t compute_count             = 0;
+    };
+
+    std::vector<Node> nodes;
+    std::unordered_map<std::string, QuantityId> by_name;
+    std::vector<QuantityId> stack;
+
+    QuantityId add_node(const std::string &name) {
+        assert(by_name.find(name) == by_name.end() &&
+               "Quantity names must be unique");
+        QuantityId id = QuantityId(nodes.size());
+        nodes.emplace_back();
+        nodes.back().name = name;
+        by_name[name]     = id;
+        return id;
+    }
+
+  public:
+    QuantityId add_input(const std::string &name) {
+        QuantityId id   = add_node(name);
+        nodes[id].dirty = false;
+        return id;
+    }
+
+    // Inputs must already exist, which keeps the graph acyclic.
+    QuantityId add_derived(const std::string &name,
+                           const std::vector<QuantityId> &inputs,
+                           std::function<void()> compute) {
+        for (QuantityId in : inputs)
+            assert(in < nodes.size() && "Unknown input quantity");
+        QuantityId id     = add_node(name);
+        nodes[id].inputs  = inputs;
+        nodes[id].compute = std::move(compute);
+        for (QuantityId in : inputs)
+            nodes[in].dependents.push_back(id);
+        return id;
+    }
+
+    // Binds a parsed `derived` declaration, resolving its inputs by name.
+    // Unknown inputs and names that are already taken are reported and
+    // return InvalidQuantity.
+    QuantityId add_derived(const dsl::DerivedDecl &decl,
+                           std::function<void()> compute) {
+        if (find(decl.name.str()) != InvalidQuantity) {
+            std::cerr << "Error: quantity '" << decl.name.str()
+                      << "' is already defined" << std::endl;
+            return InvalidQuantity;
+        }
+        std::vector<QuantityId> inputs;
+        for (const dsl::StringRef &in : decl.inputs) {
+            QuantityId id = find(in.str());
+            if (id == InvalidQuantity) {
+                std::cerr << "Error: derived quantity '" << decl.name.str()
+                          << "' uses unknown input '" << in.str() << "'"
+                          << std::endl;
+                return InvalidQuantity;
+            }
+            inputs.push_back(id);
+        }
+        return add_derived(decl.name.str(), inputs, std::move(compute));
+    }
+
+    QuantityId find(const std::string &name) const {
+        auto it = by_name.find(name);
+        return it == by_name.end() ? InvalidQuantity : it->second;
+    }
+
+    // Marks everything downstream of `id` as stale. Propagation stops at
+    // nodes that are already dirty, since their dependents are too.
+    void invalidate(QuantityId id) {
+        assert(id < nodes.size());
+        stack.clear();
+        for (QuantityId d : nodes[id].dependents)
+            stack.push_back(d);
+        while (!stack.empty()) {
+            Node &n = nodes[stack.back()];
+            stack.pop_back();
+            if (n.dirty)
+                continue;
+            n.dirty = true;
+            for (QuantityId d : n.dependents)
+                stack.push_back(d);
+        }
+    }
+
+    // Brings `id` up to date, recomputing only the dirty part of its
+    // upstream graph, inputs before dependents.
+    void require(QuantityId id) {
+        assert(id < nodes.size());
+        Node &n = nodes[id];
+        if (!n.dirty)
+            return;
+        for (QuantityId in : n.inputs)
+            require(in);
+        if (n.compute)
+            n.compute();
+        n.compute_count++;
+        n.dirty = false;
+    }
+
+    bool is_dirty(QuantityId id) const { return nodes[id].dirty; }
+
+    uint64_t compute_count(QuantityId id) const {
+        return nodes[id].compute_count;
+    }
+
+    const std::string &name(QuantityId id) const { return nodes[id].name; }
+
+    size_t size() const { return nodes.size(); }
+};
+
+// Typed handle owning the cached value of one derived quantity.
+template <typename T> class Derived {
+  private:
+    DerivedGraph *graph      = {};
+    QuantityId id            = InvalidQuantity;
+    std::shared_ptr<T> value = {};
+
+  public:
+    Derived() = default;
+
+    Derived(DerivedGraph &g, const std::string &name,
+            const std::vector<QuantityId> &inputs,
+            std::function<void(T &)> compute)
+        : graph(&g), value(std::make_shared<T>()) {
+        std::shared_ptr<T> v = value;
+        id                   = g.add_derived(name, inputs,
+                                             [v, compute] { compute(*v); });
+    }
+
+    // Recomputes on demand; reading a clean value is just a flag check.
+    const T &get() const {
+        assert(graph && "Reading an unbound derived quantity");
+        graph->require(id);
+        return *value;
+    }
+
+    QuantityId get_id() const { return id; }
+};
+
+} // namespace simly
+
+#endif // __DERIVED_HPP__
@@ -246,6 +246,59 @@ class TokenStream {
     }
 };
 
+// Declaration of a derived quantity:
+//     derived <name>(<input>, <input>, ...) <body> ;
+// Inputs are names of state columns or other derived quantities. The body
+// tokens are kept unevaluated for the runtime to compile.
+//
+// The name, input and body refs point into the TokenStream's copy of the
+// source; they are only valid while that stream is alive and unmoved. Use
+// StringRef::str() to keep them longer.
+struct DerivedDecl {
+    StringRef name                = {};
+    std::vector<StringRef> inputs = {};
+    std::vector<Token> body       = {};
+};
+
+// Parses a derived declaration at the current position. Returns false and
+// reports the error if the tokens do not form one.
+inline bool parse_derived_decl(TokenStream &ts, DerivedDecl &decl) {
+    if (!ts.consume("derived")) {
+        ts.print_error_at_current("Expected 'derived'");
+        return false;
+    }
+    if (ts.eof() || ts.peek().type != TokenType::LITERAL) {
+        ts.print_error_at_current("Expected derived quantity name");
+        return false;
+    }
+    decl.name = ts.next().value;
+    if (!ts.consume("(")) {
+        ts.print_error_at_current("Expected '(' after derived name");
+        return false;
+    }
+    decl.inputs.clear();
+    // an empty list is fine, but every ',' must be followed by a name
+    bool done = ts.consume(")");
+    while (!done) {
+        if (ts.eof() || ts.peek().type != TokenType::LITERAL) {
+            ts.print_error_at_current("Expected input name");
+            return false;
+        }
+        decl.inputs.push_back(ts.next().value);
+        done = ts.consume(")");
+        if (!done && !ts.consume(",")) {
+            ts.print_error_at_current("Expected ',' or ')'");
+            return false;
+        }
+    }
+    decl.body = ts.get_list_until({";"}, false);
+    if (!ts.consume(";")) {
+        ts.print_error_at_current("Expected ';' after derived body");
+        return false;
+    }
+    return true;
+}
+
 } // namespace dsl
 
 #endif // __DSL_HPP__
\ No newline at end of file
@@ -0,0 +1,245 @@
+//------------------------------------------------------------------------------
+//  entities.cpp
+//
+//  Instanced entity rendering straight from simulation columns.
+//------------------------------------------------------------------------------
+#include "entities.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "arena.hpp"
+#include "pipeline_cache.hpp"
+#include "profiler.hpp"
+#include "reduce.hpp"
+#include "shaders.glsl.h"
+
+namespace simly {
+
+// the 3 per-instance streams, in the order they are packed
+static const size_t PositionSize = 3 * sizeof(float);
+static const size_t ScaleSize    = sizeof(float);
+static const size_t ColorSize    = sizeof(uint32_t);
+static const size_t InstanceSize = PositionSize + ScaleSize + ColorSize;
+// entities per parallel_for range when culling and packing
+static const size_t EntityGrain = 16 * 1024;
+
+static void normalize(float v[3]) {
+    const float len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (len > 0.0f) {
+        v[0] /= len;
+        v[1] /= len;
+        v[2] /= len;
+    }
+}
+
+static void cross(const float a[3], const float b[3], float out[3]) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+EntityCamera EntityCamera::look_at(const float eye[3], const float center[3],
+                                   float fovy, float aspect, float znear,
+                                   float zfar) {
+    const float world_up[3] = {0.0f, 1.0f, 0.0f};
+    float f[3] = {center[0] - eye[0], center[1] - eye[1], center[2] - eye[2]};
+    normalize(f);
+    float s[3];
+    cross(f, world_up, s);
+    normalize(s);
+    float u[3];
+    cross(s, f, u);
+
+    // view matrix, column-major
+    float view[16] = {};
+    for (int i = 0; i < 3; i++) {
+        view[i * 4 + 0] = s[i];
+        view[i * 4 + 1] = u[i];
+        view[i * 4 + 2] = -f[i];
+    }
+    view[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+    view[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+    view[14] = f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2];
+    view[15] = 1.0f;
+
+    // perspective projection mapping [-znear, -zfar] to z in [0, 1]
+    const float t  = 1.0f / tanf(fovy * 0.5f);
+    float proj[16] = {};
+    proj[0]        = t / aspect;
+    proj[5]        = t;
+    proj[10]       = zfar / (znear - zfar);
+    proj[11]       = -1.0f;
+    proj[14]       = (znear * zfar) / (znear - zfar);
+
+    EntityCamera cam;
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += proj[k * 4 + r] * view[c * 4 + k];
+            }
+            cam.view_proj[c * 4 + r] = sum;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        cam.right[i] = s[i];
+        cam.up[i]    = u[i];
+    }
+    return cam;
+}
+
+void EntityRenderer::init(FrameRing &vertex_ring,
+                          sg_pixel_format color_format,
+                          sg_pixel_format depth_format, int sample_count) {
+    ring = &vertex_ring;
+
+    // three per-instance streams, all in the same buffer
+    PipelineCache &cache = default_pipeline_cache();
+    const sg_shader shd =
+        cache.get_shader(entity_shader_desc(shader_backend()));
+    sg_pipeline_desc pip_desc = {};
+    auto &layout              = pip_desc.layout;
+    layout.buffers[0].stride  = PositionSize;
+    layout.buffers[1].stride  = ScaleSize;
+    layout.buffers[2].stride  = ColorSize;
+    for (int i = 0; i < 3; i++) {
+        layout.buffers[i].step_func  = SG_VERTEXSTEP_PER_INSTANCE;
+        layout.attrs[i].buffer_index = i;
+    }
+    layout.attrs[0].format          = SG_VERTEXFORMAT_FLOAT3;
+    layout.attrs[1].format          = SG_VERTEXFORMAT_FLOAT;
+    layout.attrs[2].format          = SG_VERTEXFORMAT_UBYTE4N;
+    pip_desc.shader                 = shd;
+    pip_desc.depth.compare          = SG_COMPAREFUNC_LESS_EQUAL;
+    pip_desc.depth.write_enabled    = true;
+    pip_desc.depth.pixel_format     = depth_format;
+    pip_desc.colors[0].pixel_format = color_format;
+    pip_desc.sample_count           = sample_count;
+    pip_desc.label                  = "entities";
+    pip                             = cache.get(pip_desc);
+}
+
+size_t EntityRenderer::prepare(const EntityColumns &columns,
+                               const EntityCamera &cam, bool cull,
+                               ThreadPool &pool) {
+    assert(columns.x && columns.y && columns.z);
+    camera         = cam;
+    const size_t n = columns.count;
+
+    // frustum planes (a, b, c, d) from the rows of the view-projection
+    // matrix, normalized so that distances are in world units
+    float planes[6][4];
+    const float *m = cam.view_proj;
+    for (int i = 0; i < 4; i++) {
+        const float r0 = m[i * 4 + 0];
+        const float r1 = m[i * 4 + 1];
+        const float r2 = m[i * 4 + 2];
+        const float r3 = m[i * 4 + 3];
+        planes[0][i]   = r3 + r0;
+        planes[1][i]   = r3 - r0;
+        planes[2][i]   = r3 + r1;
+        planes[3][i]   = r3 - r1;
+        planes[4][i]   = r2;
+        planes[5][i]   = r3 - r2;
+    }
+    for (int p = 0; p < 6; p++) {
+        const float len = sqrtf(planes[p][0] * planes[p][0] +
+                                planes[p][1] * planes[p][1] +
+                                planes[p][2] * planes[p][2]);
+        for (int i = 0; i < 4; i++) {
+            planes[p][i] /= len;
+        }
+    }
+
+    // visible entity indices, in column order
+    const uint32_t *indices = nullptr;
+    num_visible             = n;
+    if (cull && (n > 0)) {
+        Arena &arena  = FrameArena::current();
+        uint8_t *keep = arena.allocate_array<uint8_t>(n);
+        pool.parallel_for(n, EntityGrain, [&](size_t b, size_t e, unsigned) {
+            SIMLY_PROFILE_SCOPE("cull");
+            for (size_t i = b; i < e; i++) {
+                const float s =
+                    columns.scale ? columns.scale[i] : columns.default_scale;
+                // bounding sphere of the billboard quad
+                const float radius = s * 1.415f;
+                bool inside        = true;
+                for (int p = 0; (p < 6) && inside; p++) {
+                    const float d =
+                        planes[p][0] * columns.x[i] +
+                        planes[p][1] * columns.y[i] +
+                        planes[p][2] * columns.z[i] + planes[p][3];
+                    inside = d >= -radius;
+                }
+                keep[i] = inside ? 1 : 0;
+            }
+        });
+        uint32_t *visible = arena.allocate_array<uint32_t>(n);
+        num_visible       = compact_indices(keep, n, visible, pool);
+        indices           = visible;
+    }
+    if (num_visible == 0) {
+        return 0;
+    }
+
+    // pack the streams back to back into one ring allocation
+    uint8_t *dst = nullptr;
+    ring_offset  = ring->allocate_array(num_visible * InstanceSize, &dst);
+    float *pos_dst           = (float *)dst;
+    float *scale_dst         = (float *)(dst + num_visible * PositionSize);
+    uint32_t *color_dst      = (uint32_t *)(scale_dst + num_visible);
+    const float def_scale    = columns.default_scale;
+    const uint32_t def_color = columns.default_color;
+    pool.parallel_for(num_visible, EntityGrain,
+                      [&](size_t b, size_t e, unsigned) {
+                          SIMLY_PROFILE_SCOPE("pack");
+                          for (size_t j = b; j < e; j++) {
+                              const size_t i     = indices ? indices[j] : j;
+                              pos_dst[j * 3 + 0] = columns.x[i];
+                              pos_dst[j * 3 + 1] = columns.y[i];
+                              pos_dst[j * 3 + 2] = columns.z[i];
+                              scale_dst[j] =
+                                  columns.scale ? columns.scale[i] : def_scale;
+                              color_dst[j] =
+                                  columns.color ? columns.color[i] : def_color;
+                          }
+                      });
+    return num_visible;
+}
+
+void EntityRenderer::draw() const {
+    if ((num_visible == 0) || !PipelineCache::is_ready(pip)) {
+        return;
+    }
+    entity_params_t params = {};
+    memcpy(params.view_proj, camera.view_proj, sizeof(params.view_proj));
+    for (int i = 0; i < 3; i++) {
+        params.right[i] = camera.right[i];
+        params.up[i]    = camera.up[i];
+    }
+    params.right[3] = 0.0f;
+    params.up[3]    = 0.0f;
+
+    // the ring buffer may have been recreated by commit(), so the bindings
+    // are only resolved here
+    const size_t n                = num_visible;
+    sg_bindings bind              = {};
+    bind.vertex_buffers[0]        = ring->get_buffer();
+    bind.vertex_buffers[1]        = ring->get_buffer();
+    bind.vertex_buffers[2]        = ring->get_buffer();
+    bind.vertex_buffer_offsets[0] = int(ring_offset);
+    bind.vertex_buffer_offsets[1] = int(ring_offset + n * PositionSize);
+    bind.vertex_buffer_offsets[2] =
+        int(ring_offset + n * (PositionSize + ScaleSize));
+
+    sg_apply_pipeline(pip);
+    sg_apply_bindings(&bind);
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_entity_params, SG_RANGE(params));
+    sg_draw(0, 6, int(num_visible));
+}
+
+} // namespace simly
@@ -0,0 +1,81 @@
+#ifndef __ENTITIES_HPP__
+#define __ENTITIES_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "frame_ring.hpp"
+#include "parallel.hpp"
+#include "sokol_gfx.h"
+
+namespace simly {
+
+// Read-only view of the simulation columns the entity renderer draws.
+// scale and color are optional, missing columns use the defaults. Colors
+// are packed RGBA8 with red in the lowest byte (like IM_COL32).
+struct EntityColumns {
+    const float *x         = {};
+    const float *y         = {};
+    const float *z         = {};
+    const float *scale     = {};
+    const uint32_t *color  = {};
+    size_t count           = {};
+    float default_scale    = 1.0f;
+    uint32_t default_color = 0xFFFFFFFF;
+    // bumped by the owner whenever the column contents change, views only
+    // render again for a new version or a moved camera
+    uint64_t version = {};
+};
+
+// Column-major view-projection matrix (WebGPU clip space, z in [0, 1]) and
+// the camera axes that entity billboards are aligned to.
+struct EntityCamera {
+    float view_proj[16] = {};
+    float right[3]      = {};
+    float up[3]         = {};
+
+    // Right-handed perspective camera at `eye` looking at `center`, with
+    // +y as the world up axis. fovy is in radians.
+    static EntityCamera look_at(const float eye[3], const float center[3],
+                                float fovy, float aspect, float znear,
+                                float zfar);
+};
+
+// Draws entities as camera-facing discs, one instance per entity. The
+// columns are packed into one range of the frame ring (positions, scales
+// and colors back to back) and bound at offsets as three per-instance
+// vertex streams, so the whole population is a single draw call. Entities
+// outside the view frustum can be dropped on the CPU before packing.
+class EntityRenderer {
+  private:
+    FrameRing *ring = {};
+    sg_pipeline pip = {};
+    EntityCamera camera;
+    size_t ring_offset = 0;
+    size_t num_visible = 0;
+
+  public:
+    // instances are uploaded through `vertex_ring`, a vertex buffer ring;
+    // the formats describe the pass the entities are drawn into, defaults
+    // are the swapchain's
+    void init(FrameRing &vertex_ring,
+              sg_pixel_format color_format = _SG_PIXELFORMAT_DEFAULT,
+              sg_pixel_format depth_format = _SG_PIXELFORMAT_DEFAULT,
+              int sample_count             = 0);
+
+    // Culls the columns and packs the visible entities into the ring. Must
+    // be called once per frame between FrameRing::begin_frame() and
+    // commit(). Returns the number of visible entities.
+    size_t prepare(const EntityColumns &columns, const EntityCamera &cam,
+                   bool cull = true, ThreadPool &pool = default_pool());
+
+    // Draws the entities of the last prepare() call. Must be called inside
+    // a pass with a depth buffer.
+    void draw() const;
+
+    size_t get_num_visible() const { return num_visible; }
+};
+
+} // namespace simly
+
+#endif // __ENTITIES_HPP__
@@ -0,0 +1,201 @@
+#ifndef __EVENTS_HPP__
+#define __EVENTS_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "parallel.hpp"
+
+namespace simly {
+
+// Entity-to-entity messages (collisions, spawns, damage, ...).
+//
+// During a tick every worker appends to its own buffer without locking.
+// flush() concatenates the buffers and radix sorts the events by
+// (target, source). Delivery then walks the targets in ascending order, so
+// handlers touch entity columns sequentially rather than at random. Each
+// source entity is processed by a single worker, which makes the order of
+// events with equal (target, source) the order they were pushed in. The
+// delivered order is therefore the same for any thread count or schedule.
+template <typename Payload> class EventQueue {
+  public:
+    struct Event {
+        uint32_t target = {};
+        uint32_t source = {};
+        Payload payload = {};
+    };
+
+  private:
+    struct SortItem {
+        uint64_t key   = {};
+        uint32_t index = {};
+    };
+
+    static const size_t SortChunk  = 32 * 1024;
+    static const unsigned DigitBits = 8;
+    static const size_t NumDigits   = size_t(1) << DigitBits;
+
+    ThreadPool &pool;
+    std::vector<std::vector<Event>> buffers;
+    std::vector<Event> merged;
+    std::vector<Event> sorted;
+    std::vector<SortItem> items;
+    std::vector<SortItem> items_tmp;
+    std::vector<size_t> histograms;
+    std::vector<size_t> group_starts;
+
+    size_t num_chunks(size_t n) const {
+        return (n + SortChunk - 1) / SortChunk;
+    }
+
+    // One stable LSD pass over `shift`. Returns false if every key has the
+    // same digit, in which case the pass is skipped.
+    bool radix_pass(unsigned shift) {
+        const size_t n      = items.size();
+        const size_t chunks = num_chunks(n);
+        histograms.assign(chunks * NumDigits, 0);
+        pool.parallel_for(chunks, 1, [&](size_t cb, size_t ce, unsigned) {
+            for (size_t c = cb; c < ce; c++) {
+                size_t *h      = &histograms[c * NumDigits];
+                const size_t e = std::min(n, (c + 1) * SortChunk);
+                for (size_t i = c * SortChunk; i < e; i++)
+                    h[(items[i].key >> shift) & (NumDigits - 1)]++;
+            }
+        });
+        // exclusive scan in (digit, chunk) order keeps the pass stable
+        size_t total = 0;
+        for (size_t d = 0; d < NumDigits; d++) {
+            size_t digit_count = 0;
+            for (size_t c = 0; c < chunks; c++) {
+                size_t &h = histograms[c * NumDigits + d];
+                digit_count += h;
+                const size_t count = h;
+                h                  = total;
+                total += count;
+            }
+            if (digit_count == n)
+                return false;
+        }
+        items_tmp.resize(n);
+        pool.parallel_for(chunks, 1, [&](size_t cb, size_t ce, unsigned) {
+            for (size_t c = cb; c < ce; c++) {
+                size_t *h      = &histograms[c * NumDigits];
+                const size_t e = std::min(n, (c + 1) * SortChunk);
+                for (size_t i = c * SortChunk; i < e; i++)
+                    items_tmp[h[(items[i].key >> shift) & (NumDigits - 1)]++] =
+                        items[i];
+            }
+        });
+        items.swap(items_tmp);
+        return true;
+    }
+
+  public:
+    explicit EventQueue(ThreadPool &pool = default_pool())
+        : pool(pool), buffers(pool.size()) {}
+
+    // Appends an event from `worker` (the worker index passed by
+    // ThreadPool::parallel_for). Only that worker may push to its buffer.
+    void push(unsigned worker, uint32_t target, uint32_t source,
+              const Payload &payload) {
+        assert(worker < buffers.size());
+        Event ev;
+        ev.target  = target;
+        ev.source  = source;
+        ev.payload = payload;
+        buffers[worker].push_back(ev);
+    }
+
+    // Merges the per-worker buffers and sorts them for delivery. Buffers
+    // keep their capacity, so steady-state ticks do not allocate.
+    size_t flush() {
+        size_t total = 0;
+        for (const std::vector<Event> &b : buffers)
+            total += b.size();
+        merged.clear();
+        merged.reserve(total);
+        for (std::vector<Event> &b : buffers) {
+            merged.insert(merged.end(), b.begin(), b.end());
+            b.clear();
+        }
+        items.resize(total);
+        pool.parallel_for(total, SortChunk,
+                          [&](size_t b, size_t e, unsigned) {
+                              for (size_t i = b; i < e; i++) {
+                                  items[i].key =
+                                      (uint64_t(merged[i].target) << 32) |
+                                      merged[i].source;
+                                  items[i].index = uint32_t(i);
+                              }
+                          });
+        // sources are ordered within each buffer only; a full sort on the
+        // combined key makes the result independent of buffer order
+        for (unsigned shift = 0; shift < 64; shift += DigitBits)
+            radix_pass(shift);
+        sorted.resize(total);
+        pool.parallel_for(total, SortChunk, [&](size_t b, size_t e, unsigned) {
+            for (size_t i = b; i < e; i++)
+                sorted[i] = merged[items[i].index];
+        });
+        return total;
+    }
+
+    // Calls handler(target, begin, end) once per target, in ascending target
+    // order, with all events for that target. Serial.
+    template <typename F> void deliver(const F &handler) const {
+        size_t i = 0;
+        while (i < sorted.size()) {
+            size_t j = i + 1;
+            while (j < sorted.size() && sorted[j].target == sorted[i].target)
+                j++;
+            handler(sorted[i].target, sorted.data() + i, sorted.data() + j);
+            i = j;
+        }
+    }
+
+    // Like deliver(), but spreads targets over the pool. All events of one
+    // target go to a single call, so handlers may write to their target
+    // entity without synchronization.
+    template <typename F> void deliver_parallel(const F &handler) {
+        const size_t n      = sorted.size();
+        const size_t chunks = num_chunks(n);
+        group_starts.resize(chunks + 1);
+        for (size_t c = 0; c < chunks; c++) {
+            size_t s = c * SortChunk;
+            while (s > 0 && s < n && sorted[s].target == sorted[s - 1].target)
+                s++;
+            group_starts[c] = s;
+        }
+        group_starts[chunks] = n;
+        pool.parallel_for(chunks, 1, [&](size_t cb, size_t ce, unsigned) {
+            for (size_t c = cb; c < ce; c++) {
+                size_t i       = group_starts[c];
+                const size_t e = std::max(i, group_starts[c + 1]);
+                while (i < e) {
+                    size_t j = i + 1;
+                    while (j < e && sorted[j].target == sorted[i].target)
+                        j++;
+                    handler(sorted[i].target, sorted.data() + i,
+                            sorted.data() + j);
+                    i = j;
+                }
+            }
+        });
+    }
+
+    const std::vector<Event> &get_sorted() const { return sorted; }
+
+    void clear() {
+        for (std::vector<Event> &b : buffers)
+            b.clear();
+        sorted.clear();
+    }
+};
+
+} // namespace simly
+
+#endif // __EVENTS_HPP__
@@ -0,0 +1,240 @@
+//------------------------------------------------------------------------------
+//  font_cache.cpp
+//
+//  Save and restore baked ImGui font atlases.
+//------------------------------------------------------------------------------
+#include "font_cache.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace simly {
+
+static const uint32_t FontCacheMagic   = 0x46414D53; // 'SMAF'
+static const uint32_t FontCacheVersion = 1;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    int32_t tex_width;
+    int32_t tex_height;
+    int32_t num_fonts;
+    int32_t num_custom_rects;
+} font_cache_header_t;
+
+typedef struct {
+    float font_size;
+    float ascent;
+    float descent;
+    int32_t num_glyphs;
+} font_cache_font_t;
+
+static uint64_t hash_bytes(uint64_t h, const void *ptr, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)ptr;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return h;
+}
+
+template <typename T> static uint64_t hash_value(uint64_t h, const T &v) {
+    return hash_bytes(h, &v, sizeof(T));
+}
+
+// everything the baked atlas depends on
+static uint64_t atlas_key(const ImFontAtlas *atlas) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    h          = hash_value(h, IMGUI_VERSION_NUM);
+    h          = hash_value(h, sizeof(ImFontGlyph));
+    h          = hash_value(h, sizeof(ImFontAtlasCustomRect));
+    h          = hash_value(h, sizeof(ImWchar));
+    h          = hash_value(h, atlas->Flags);
+    h          = hash_value(h, atlas->TexDesiredWidth);
+    h          = hash_value(h, atlas->TexGlyphPadding);
+    for (const ImFontConfig &cfg : atlas->ConfigData) {
+        h = hash_bytes(h, cfg.FontData, (size_t)cfg.FontDataSize);
+        h = hash_value(h, cfg.FontNo);
+        h = hash_value(h, cfg.SizePixels);
+        h = hash_value(h, cfg.OversampleH);
+        h = hash_value(h, cfg.OversampleV);
+        h = hash_value(h, cfg.PixelSnapH);
+        h = hash_value(h, cfg.GlyphExtraSpacing);
+        h = hash_value(h, cfg.GlyphOffset);
+        h = hash_value(h, cfg.GlyphMinAdvanceX);
+        h = hash_value(h, cfg.GlyphMaxAdvanceX);
+        h = hash_value(h, cfg.MergeMode);
+        h = hash_value(h, cfg.FontBuilderFlags);
+        h = hash_value(h, cfg.RasterizerMultiply);
+        h = hash_value(h, cfg.EllipsisChar);
+        if (cfg.GlyphRanges) {
+            for (const ImWchar *r = cfg.GlyphRanges; *r; r++) {
+                h = hash_value(h, *r);
+            }
+        }
+    }
+    return h;
+}
+
+static bool read_bytes(FILE *fp, void *dst, size_t size) {
+    return fread(dst, 1, size, fp) == size;
+}
+
+static bool write_bytes(FILE *fp, const void *src, size_t size) {
+    return fwrite(src, 1, size, fp) == size;
+}
+
+bool load_font_atlas(ImFontAtlas *atlas, const char *path) {
+    IM_ASSERT(atlas && path);
+    IM_ASSERT(!atlas->IsBuilt() && (atlas->Fonts.Size > 0));
+    // merged fonts share one ImFont, keep it simple and bake only atlases
+    // with one config per font
+    if (atlas->ConfigData.Size != atlas->Fonts.Size) {
+        return false;
+    }
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        return false;
+    }
+    font_cache_header_t hdr;
+    bool ok = read_bytes(fp, &hdr, sizeof(hdr)) &&
+              (hdr.magic == FontCacheMagic) &&
+              (hdr.version == FontCacheVersion) &&
+              (hdr.key == atlas_key(atlas)) &&
+              (hdr.num_fonts == atlas->Fonts.Size) && (hdr.tex_width > 0) &&
+              (hdr.tex_height > 0) && (hdr.num_custom_rects >= 0);
+
+    // atlas level data
+    ImVec2 uv_scale, uv_white;
+    ImVector<ImFontAtlasCustomRect> rects;
+    int pack_id_cursors = -1, pack_id_lines = -1;
+    ok = ok && read_bytes(fp, &uv_scale, sizeof(uv_scale)) &&
+         read_bytes(fp, &uv_white, sizeof(uv_white)) &&
+         read_bytes(fp, &pack_id_cursors, sizeof(int)) &&
+         read_bytes(fp, &pack_id_lines, sizeof(int));
+    ImVec4 uv_lines[IM_ARRAYSIZE(atlas->TexUvLines)];
+    ok = ok && read_bytes(fp, uv_lines, sizeof(uv_lines));
+    if (ok) {
+        rects.resize(hdr.num_custom_rects);
+        ok = read_bytes(fp, rects.Data, rects.size_in_bytes());
+    }
+
+    // per font metrics and glyphs
+    std::vector<font_cache_font_t> fonts;
+    std::vector<ImVector<ImFontGlyph>> glyphs;
+    if (ok) {
+        fonts.resize(hdr.num_fonts);
+        glyphs.resize(hdr.num_fonts);
+    }
+    for (int i = 0; ok && (i < hdr.num_fonts); i++) {
+        ok = read_bytes(fp, &fonts[i], sizeof(font_cache_font_t)) &&
+             (fonts[i].num_glyphs >= 0);
+        if (ok) {
+            glyphs[i].resize(fonts[i].num_glyphs);
+            ok = read_bytes(fp, glyphs[i].Data, glyphs[i].size_in_bytes());
+        }
+    }
+
+    // the alpha-only texture
+    unsigned char *pixels = nullptr;
+    if (ok) {
+        const size_t num_pixels = (size_t)hdr.tex_width * hdr.tex_height;
+        pixels                  = (unsigned char *)IM_ALLOC(num_pixels);
+        ok                      = read_bytes(fp, pixels, num_pixels);
+    }
+    fclose(fp);
+    if (!ok) {
+        if (pixels) {
+            IM_FREE(pixels);
+        }
+        return false;
+    }
+
+    // everything was read, now install it like ImFontAtlas::Build() would
+    for (ImFontAtlasCustomRect &r : rects) {
+        r.Font = nullptr;
+    }
+    atlas->CustomRects        = rects;
+    atlas->PackIdMouseCursors = pack_id_cursors;
+    atlas->PackIdLines        = pack_id_lines;
+    atlas->TexWidth           = hdr.tex_width;
+    atlas->TexHeight          = hdr.tex_height;
+    atlas->TexUvScale         = uv_scale;
+    atlas->TexUvWhitePixel    = uv_white;
+    memcpy(atlas->TexUvLines, uv_lines, sizeof(uv_lines));
+    atlas->TexPixelsAlpha8 = pixels;
+    for (int i = 0; i < hdr.num_fonts; i++) {
+        ImFont *font            = atlas->Fonts[i];
+        const ImFontConfig &cfg = atlas->ConfigData[i];
+        font->ClearOutputData();
+        font->FontSize        = fonts[i].font_size;
+        font->Ascent          = fonts[i].ascent;
+        font->Descent         = fonts[i].descent;
+        font->ConfigData      = &cfg;
+        font->ConfigDataCount = 1;
+        font->ContainerAtlas  = atlas;
+        font->EllipsisChar    = cfg.EllipsisChar;
+        font->Glyphs          = glyphs[i];
+        font->BuildLookupTable();
+    }
+    atlas->TexReady = true;
+    return true;
+}
+
+bool save_font_atlas(ImFontAtlas *atlas, const char *path) {
+    IM_ASSERT(atlas && path);
+    unsigned char *pixels;
+    int width, height;
+    atlas->GetTexDataAsAlpha8(&pixels, &width, &height);
+    if (!pixels || (atlas->ConfigData.Size != atlas->Fonts.Size)) {
+        return false;
+    }
+    // custom rects which belong to a font (user glyphs) are not supported
+    for (const ImFontAtlasCustomRect &r : atlas->CustomRects) {
+        if (r.Font) {
+            return false;
+        }
+    }
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        return false;
+    }
+    font_cache_header_t hdr;
+    hdr.magic            = FontCacheMagic;
+    hdr.version          = FontCacheVersion;
+    hdr.key              = atlas_key(atlas);
+    hdr.tex_width        = width;
+    hdr.tex_height       = height;
+    hdr.num_fonts        = atlas->Fonts.Size;
+    hdr.num_custom_rects = atlas->CustomRects.Size;
+
+    bool ok = write_bytes(fp, &hdr, sizeof(hdr));
+    ok      = ok && write_bytes(fp, &atlas->TexUvScale, sizeof(ImVec2));
+    ok      = ok && write_bytes(fp, &atlas->TexUvWhitePixel, sizeof(ImVec2));
+    ok      = ok && write_bytes(fp, &atlas->PackIdMouseCursors, sizeof(int));
+    ok      = ok && write_bytes(fp, &atlas->PackIdLines, sizeof(int));
+    ok = ok && write_bytes(fp, atlas->TexUvLines, sizeof(atlas->TexUvLines));
+    ok = ok && write_bytes(fp, atlas->CustomRects.Data,
+                           atlas->CustomRects.size_in_bytes());
+    for (int i = 0; ok && (i < atlas->Fonts.Size); i++) {
+        const ImFont *font = atlas->Fonts[i];
+        font_cache_font_t f;
+        f.font_size  = font->FontSize;
+        f.ascent     = font->Ascent;
+        f.descent    = font->Descent;
+        f.num_glyphs = font->Glyphs.Size;
+        ok           = write_bytes(fp, &f, sizeof(f));
+        ok = ok && write_bytes(fp, font->Glyphs.Data,
+                               font->Glyphs.size_in_bytes());
+    }
+    ok = ok && write_bytes(fp, pixels, (size_t)width * height);
+    fclose(fp);
+    if (!ok) {
+        remove(path);
+    }
+    return ok;
+}
+
+} // namespace simly
@@ -0,0 +1,25 @@
+#ifndef __FONT_CACHE_HPP__
+#define __FONT_CACHE_HPP__
+
+#include "imgui.h"
+
+namespace simly {
+
+// Baked ImGui font atlas cache.
+//
+// After the fonts have been added to the atlas (but before it is built),
+// load_font_atlas() restores a previously saved atlas: the alpha-only
+// texture, the glyph tables and the atlas UVs. This skips rasterizing the
+// glyphs at startup. The file is keyed by the ImGui version and by all
+// font and atlas settings, a mismatch or a missing file returns false and
+// the atlas has to be built as usual and then stored with
+// save_font_atlas().
+//
+// Restoring writes ImFont and ImFontAtlas build outputs directly, which is
+// why the ImGui version is part of the key.
+bool load_font_atlas(ImFontAtlas *atlas, const char *path);
+bool save_font_atlas(ImFontAtlas *atlas, const char *path);
+
+} // namespace simly
+
+#endif // __FONT_CACHE_HPP__
@@ -0,0 +1,132 @@
+#ifndef __FRAME_RING_HPP__
+#define __FRAME_RING_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sokol_gfx.h"
+
+namespace simly {
+
+// Shared per-frame upload buffer. Producers (ImGui geometry, plots,
+// entity instances, ...) sub-allocate aligned ranges from a CPU staging
+// area during the frame, commit() then uploads everything with a single
+// sg_update_buffer and the producers bind the buffer at their offsets.
+//
+// One region per in-flight frame plus fences is not needed here: sokol
+// allows one update per buffer and frame, and on WebGPU that update is a
+// queue write which is ordered after all previously submitted GPU work, so
+// a single region can be overwritten every frame.
+class FrameRing {
+  private:
+    sg_buffer buf       = {};
+    sg_buffer_type type = {};
+    std::vector<uint8_t> staging;
+    size_t head       = 0;
+    size_t capacity   = 0;
+    size_t high_water = 0;
+    size_t alignment  = 16;
+    uint32_t grows    = 0;
+    bool committed    = false;
+
+    void make_buffer(size_t size) {
+        if (buf.id != SG_INVALID_ID) {
+            sg_destroy_buffer(buf);
+        }
+        sg_buffer_desc desc = {};
+        desc.type           = type;
+        desc.usage          = SG_USAGE_STREAM;
+        desc.size           = size;
+        buf                 = sg_make_buffer(&desc);
+        capacity            = size;
+    }
+
+  public:
+    // `align` is the minimum alignment of every allocation, WebGPU wants
+    // vertex and index buffer offsets to be multiples of 4.
+    void init(sg_buffer_type buffer_type, size_t initial_size,
+              size_t align = 16) {
+        assert((align >= 4) && ((align & (align - 1)) == 0));
+        type      = buffer_type;
+        alignment = align;
+        make_buffer(std::max(initial_size, align));
+    }
+
+    void shutdown() {
+        if (buf.id != SG_INVALID_ID) {
+            sg_destroy_buffer(buf);
+            buf = {};
+        }
+    }
+
+    // Drops all allocations of the previous frame.
+    void begin_frame() {
+        head      = 0;
+        committed = false;
+    }
+
+    // Reserves `size` bytes and returns their offset in the buffer.
+    // Pointers from get_ptr() are invalidated by the next allocation.
+    size_t allocate(size_t size, size_t align = 0) {
+        assert(!committed);
+        align               = std::max(align, alignment);
+        const size_t offset = (head + align - 1) & ~(align - 1);
+        head                = offset + size;
+        if (head > staging.size()) {
+            staging.resize(std::max(head, staging.size() * 2));
+        }
+        return offset;
+    }
+
+    void *get_ptr(size_t offset) {
+        assert(offset <= head);
+        return staging.data() + offset;
+    }
+
+    // Allocates room for `count` elements of T and returns the offset;
+    // `out_ptr` receives the CPU address to write them to.
+    template <typename T> size_t allocate_array(size_t count, T **out_ptr) {
+        const size_t offset = allocate(count * sizeof(T), alignof(T));
+        *out_ptr            = (T *)get_ptr(offset);
+        return offset;
+    }
+
+    // Uploads all allocations of this frame. Must be called once per frame
+    // outside of a pass; the buffer is recreated if it is too small, so
+    // get_buffer() must only be read after this.
+    void commit() {
+        assert(!committed);
+        committed = true;
+        if (head == 0) {
+            return;
+        }
+        // WebGPU queue writes must be a multiple of 4 bytes
+        head = (head + 3) & ~size_t(3);
+        if (head > staging.size()) {
+            staging.resize(head);
+        }
+        high_water = std::max(high_water, head);
+        if (head > capacity) {
+            size_t size = capacity;
+            while (size < high_water + high_water / 4) {
+                size *= 2;
+            }
+            make_buffer(size);
+            grows++;
+        }
+        sg_update_buffer(buf, {staging.data(), head});
+    }
+
+    sg_buffer get_buffer() const { return buf; }
+    size_t get_used() const { return head; }
+    size_t get_capacity() const { return capacity; }
+    size_t get_high_water() const { return high_water; }
+    uint32_t get_num_grows() const { return grows; }
+};
+
+} // namespace simly
+
+#endif // __FRAME_RING_HPP__
@@ -0,0 +1,166 @@
+#ifndef __PARALLEL_HPP__
+#define __PARALLEL_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace simly {
+
+// Fixed-size pool of worker threads. The calling thread always takes part
+// in a job as worker 0, so a pool of size 1 runs everything inline. Web
+// builds without pthreads have no threads to spawn and always get size 1.
+class ThreadPool {
+  private:
+    // one per job the calling thread takes part in, innermost first
+    struct WorkerSlot {
+        const ThreadPool *pool  = {};
+        unsigned index          = {};
+        const WorkerSlot *outer = {};
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::mutex run_mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(unsigned)> *job = {};
+    uint64_t generation                      = {};
+    unsigned pending                         = {};
+    bool quit                                = {};
+
+    static const WorkerSlot *&worker_slot() {
+        static thread_local const WorkerSlot *slot = nullptr;
+        return slot;
+    }
+
+    // the calling thread's slot in a job of this pool, null outside of one
+    const WorkerSlot *find_slot() const {
+        for (const WorkerSlot *s = worker_slot(); s; s = s->outer) {
+            if (s->pool == this)
+                return s;
+        }
+        return nullptr;
+    }
+
+    void worker_main(unsigned index) {
+        const WorkerSlot slot = {this, index, nullptr};
+        worker_slot()         = &slot;
+        uint64_t seen         = 0;
+        for (;;) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen                                     = generation;
+            const std::function<void(unsigned)> *fn = job;
+            lock.unlock();
+            (*fn)(index);
+            lock.lock();
+            if (--pending == 0)
+                done.notify_one();
+        }
+    }
+
+  public:
+    explicit ThreadPool(unsigned num_threads = 0) {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+        num_threads = 1;
+#endif
+        if (num_threads == 0)
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned i = 1; i < num_threads; i++)
+            workers.emplace_back([this, i] { worker_main(i); });
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread &t : workers)
+            t.join();
+    }
+
+    ThreadPool(const ThreadPool &)            = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Number of workers, including the calling thread.
+    unsigned size() const { return unsigned(workers.size()) + 1; }
+
+    // Worker index of the calling thread in this pool: its own index on the
+    // pool's threads, 0 on the thread that started the running job and on
+    // any other thread.
+    unsigned current_worker() const {
+        const WorkerSlot *slot = find_slot();
+        return slot ? slot->index : 0;
+    }
+
+    // Runs fn(worker_index) once on every worker and waits for all of them.
+    // Calls made from inside a running job of this pool execute inline on
+    // the caller, so nested parallel code degrades to serial instead of
+    // deadlocking. The inline call still gets the caller's own worker
+    // index, so per-worker state is never shared between threads. A job of
+    // another pool is dispatched normally, with the caller as worker 0;
+    // pools must not call into each other in a cycle.
+    void run(const std::function<void(unsigned)> &fn) {
+        if (workers.empty() || find_slot()) {
+            fn(current_worker());
+            return;
+        }
+        std::lock_guard<std::mutex> run_lock(run_mutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job     = &fn;
+            pending = unsigned(workers.size());
+            generation++;
+        }
+        wake.notify_all();
+        const WorkerSlot slot = {this, 0, worker_slot()};
+        worker_slot()         = &slot;
+        fn(0);
+        worker_slot() = slot.outer;
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return pending == 0; });
+        job = nullptr;
+    }
+
+    // Splits [0, count) into chunks of `grain` items and hands them out to
+    // workers as fn(chunk_begin, chunk_end, worker_index).
+    template <typename F>
+    void parallel_for(size_t count, size_t grain, const F &fn) {
+        if (count == 0)
+            return;
+        grain = std::max<size_t>(grain, 1);
+        if (count <= grain) {
+            fn(size_t(0), count, current_worker());
+            return;
+        }
+        std::atomic<size_t> next{0};
+        run([&](unsigned worker) {
+            for (;;) {
+                const size_t begin = next.fetch_add(grain);
+                if (begin >= count)
+                    break;
+                fn(begin, std::min(begin + grain, count), worker);
+            }
+        });
+    }
+};
+
+// Process-wide pool sized to the hardware concurrency.
+inline ThreadPool &default_pool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+} // namespace simly
+
+#endif // __PARALLEL_HPP__
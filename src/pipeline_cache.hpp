@@ -0,0 +1,135 @@
+#ifndef __PIPELINE_CACHE_HPP__
+#define __PIPELINE_CACHE_HPP__
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+#include "sokol_gfx.h"
+
+namespace simly {
+
+// Shader and pipeline objects shared by all renderers.
+//
+// Shaders are keyed by their sg_shader_desc, which for shaders generated by
+// sokol-shdc is a static object, so every program is created once.
+// Pipelines are keyed by a hash of the full sg_pipeline_desc (compared
+// byte-wise on a hit, descriptors must be zero-initialized with `= {}`).
+//
+// A deferred pipeline is only allocated by get(); the expensive backend
+// object is created later by update(), at most `budget` per frame. Users
+// must check is_ready() and skip their draws until then, so startup and
+// newly added renderers never block a frame on pipeline compilation.
+class PipelineCache {
+  private:
+    struct Entry {
+        sg_pipeline_desc desc = {};
+        sg_pipeline pip       = {};
+    };
+
+    std::unordered_map<const sg_shader_desc *, sg_shader> shaders;
+    std::unordered_multimap<uint64_t, Entry> pipelines;
+    std::deque<Entry> pending;
+    int num_created = 0;
+
+    static uint64_t hash_desc(const sg_pipeline_desc &desc) {
+        const uint8_t *bytes = (const uint8_t *)&desc;
+        uint64_t h           = 0xCBF29CE484222325ull;
+        for (size_t i = 0; i < sizeof(desc); i++) {
+            h = (h ^ bytes[i]) * 0x100000001B3ull;
+        }
+        return h;
+    }
+
+  public:
+    sg_shader get_shader(const sg_shader_desc *desc) {
+        assert(desc);
+        auto it = shaders.find(desc);
+        if (it != shaders.end()) {
+            return it->second;
+        }
+        const sg_shader shd = sg_make_shader(desc);
+        shaders[desc]       = shd;
+        return shd;
+    }
+
+    sg_pipeline get(const sg_pipeline_desc &in_desc, bool deferred = true) {
+        // the key is hashed and compared byte-wise, padding included; a
+        // copy assignment may leave the padding indeterminate, so copy the
+        // caller's zero-initialized bytes into zeroed memory instead. Labels
+        // only matter for debugging, they are not part of the key.
+        sg_pipeline_desc desc;
+        memset(&desc, 0, sizeof(desc));
+        memcpy(&desc, &in_desc, sizeof(desc));
+        desc.label          = nullptr;
+        const uint64_t hash = hash_desc(desc);
+        auto range          = pipelines.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (memcmp(&it->second.desc, &desc, sizeof(desc)) == 0) {
+                return it->second.pip;
+            }
+        }
+        Entry entry;
+        memcpy(&entry.desc, &desc, sizeof(desc));
+        if (deferred) {
+            entry.pip = sg_alloc_pipeline();
+            pending.push_back(entry);
+        } else {
+            entry.pip = sg_make_pipeline(&desc);
+            num_created++;
+        }
+        pipelines.emplace(hash, entry);
+        return entry.pip;
+    }
+
+    // Creates up to `budget` deferred pipelines. Call once per frame,
+    // outside of a pass.
+    void update(int budget = 1) {
+        for (; (budget > 0) && !pending.empty(); budget--) {
+            const Entry &entry = pending.front();
+            sg_init_pipeline(entry.pip, &entry.desc);
+            pending.pop_front();
+            num_created++;
+        }
+    }
+
+    static bool is_ready(sg_pipeline pip) {
+        return sg_query_pipeline_state(pip) == SG_RESOURCESTATE_VALID;
+    }
+
+    int get_num_pending() const { return int(pending.size()); }
+    int get_num_created() const { return num_created; }
+
+    void shutdown() {
+        for (auto &kv : pipelines) {
+            sg_destroy_pipeline(kv.second.pip);
+        }
+        for (auto &kv : shaders) {
+            sg_destroy_shader(kv.second);
+        }
+        pipelines.clear();
+        shaders.clear();
+        pending.clear();
+    }
+};
+
+// Backend to pick sokol-shdc generated shader code for. The dummy backend
+// (null platform) compiles no shaders, but still validates the shader
+// descriptions, so any generated variant is used there.
+inline sg_backend shader_backend() {
+    const sg_backend backend = sg_query_backend();
+    return (backend == SG_BACKEND_DUMMY) ? SG_BACKEND_GLCORE : backend;
+}
+
+// Process-wide cache used by the renderers.
+inline PipelineCache &default_pipeline_cache() {
+    static PipelineCache cache;
+    return cache;
+}
+
+} // namespace simly
+
+#endif // __PIPELINE_CACHE_HPP__
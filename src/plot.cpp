@@ -0,0 +1,224 @@
+//------------------------------------------------------------------------------
+//  plot.cpp
+//
+//  GPU line and point plots drawn from ImGui draw callbacks.
+//------------------------------------------------------------------------------
+#include "plot.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "pipeline_cache.hpp"
+#include "shaders.glsl.h"
+
+namespace simly {
+
+static uint64_t hash_bytes(uint64_t h, const void *ptr, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)ptr;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return h;
+}
+
+template <typename T> static uint64_t hash_value(uint64_t h, const T &v) {
+    return hash_bytes(h, &v, sizeof(T));
+}
+
+void PlotRenderer::init(FrameRing &vertex_ring) {
+    ring = &vertex_ring;
+
+    // the sample buffer is bound twice, the second binding one sample
+    // further in, so every instance reads a pair of consecutive samples
+    PipelineCache &cache = default_pipeline_cache();
+    const sg_shader shd =
+        cache.get_shader(plot_shader_desc(shader_backend()));
+    sg_pipeline_desc pip_desc = {};
+    auto &layout              = pip_desc.layout;
+    for (int i = 0; i < 2; i++) {
+        layout.buffers[i].stride     = 2 * sizeof(float);
+        layout.buffers[i].step_func  = SG_VERTEXSTEP_PER_INSTANCE;
+        layout.attrs[i].buffer_index = i;
+        layout.attrs[i].format       = SG_VERTEXFORMAT_FLOAT2;
+    }
+    pip_desc.shader                         = shd;
+    pip_desc.colors[0].blend.enabled        = true;
+    pip_desc.colors[0].blend.src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA;
+    pip_desc.colors[0].blend.dst_factor_rgb =
+        SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA;
+    pip_desc.colors[0].write_mask = SG_COLORMASK_RGB;
+    pip_desc.label                = "plot";
+    pip                           = cache.get(pip_desc);
+}
+
+// Appends the visible samples of a series to the staging area. Series
+// denser than two samples per pixel column are reduced to the min and max
+// sample of every column, in sample order, which keeps the envelope of the
+// curve intact. One sample on each side of the visible range is kept so
+// lines run to the plot edges.
+size_t PlotRenderer::append_decimated(const PlotSeries &s, float x_min,
+                                      float x_max, int columns) {
+    size_t begin = size_t(std::lower_bound(s.x, s.x + s.count, x_min) - s.x);
+    size_t end   = size_t(std::upper_bound(s.x, s.x + s.count, x_max) - s.x);
+    begin        = (begin > 0) ? begin - 1 : begin;
+    end          = (end < s.count) ? end + 1 : end;
+    if (end <= begin) {
+        return 0;
+    }
+    if (end - begin <= size_t(2 * columns)) {
+        for (size_t i = begin; i < end; i++) {
+            staging.push_back(s.x[i]);
+            staging.push_back(s.y[i]);
+        }
+        return end - begin;
+    }
+    const float scale = float(columns) / (x_max - x_min);
+    auto column       = [&](size_t i) {
+        return std::min(std::max(int((s.x[i] - x_min) * scale), 0),
+                        columns - 1);
+    };
+    size_t written = 0;
+    size_t i       = begin;
+    while (i < end) {
+        const int col = column(i);
+        size_t lo     = i;
+        size_t hi     = i;
+        size_t j      = i + 1;
+        for (; (j < end) && (column(j) == col); j++) {
+            if (s.y[j] < s.y[lo]) {
+                lo = j;
+            }
+            if (s.y[j] > s.y[hi]) {
+                hi = j;
+            }
+        }
+        const size_t first = std::min(lo, hi);
+        const size_t last  = std::max(lo, hi);
+        staging.push_back(s.x[first]);
+        staging.push_back(s.y[first]);
+        written++;
+        if (last != first) {
+            staging.push_back(s.x[last]);
+            staging.push_back(s.y[last]);
+            written++;
+        }
+        i = j;
+    }
+    return written;
+}
+
+void PlotRenderer::plot(ImDrawList *dl, ImVec2 pos, ImVec2 size,
+                        const PlotSeries *series, int num_series, float x_min,
+                        float x_max, float y_min, float y_max) {
+    assert(dl && (x_max > x_min) && (y_max > y_min));
+    if (uploaded) {
+        draws.clear();
+        uploaded = false;
+    }
+    const int columns = std::max(int(size.x), 1);
+    for (int i = 0; i < num_series; i++) {
+        const PlotSeries &s = series[i];
+        Draw d;
+        d.renderer    = this;
+        d.first_point = get_num_points();
+        d.num_points  = int(append_decimated(s, x_min, x_max, columns));
+        if (d.num_points == 0) {
+            continue;
+        }
+        d.rect[0]  = pos.x;
+        d.rect[1]  = pos.y;
+        d.rect[2]  = pos.x + size.x;
+        d.rect[3]  = pos.y + size.y;
+        d.range[0] = x_min;
+        d.range[1] = x_max;
+        d.range[2] = y_min;
+        d.range[3] = y_max;
+        for (int c = 0; c < 4; c++) {
+            d.color[c] = float((s.color >> (8 * c)) & 0xFF) / 255.0f;
+        }
+        d.thickness = s.thickness;
+        d.points    = s.points;
+        draws.push_back(d);
+        dl->AddCallback(draw_callback, &draws.back());
+    }
+}
+
+// the decimated samples and the draw parameters of this frame's plots
+uint64_t PlotRenderer::content_key() const {
+    uint64_t h = 0xCBF29CE484222325ull;
+    if (uploaded) {
+        // nothing plotted yet, the draw records are the previous frame's
+        return h;
+    }
+    h          = hash_bytes(h, staging.data(), staging.size() * sizeof(float));
+    for (const Draw &d : draws) {
+        h = hash_value(h, d.num_points);
+        h = hash_bytes(h, d.rect, sizeof(d.rect));
+        h = hash_bytes(h, d.range, sizeof(d.range));
+        h = hash_bytes(h, d.color, sizeof(d.color));
+        h = hash_value(h, d.thickness);
+        h = hash_value(h, d.points);
+    }
+    return h;
+}
+
+void PlotRenderer::upload() {
+    uploaded_key    = content_key();
+    uploaded_points = get_num_points();
+    if (uploaded_points > 0) {
+        float *dst;
+        ring_offset = ring->allocate_array(staging.size(), &dst);
+        memcpy(dst, staging.data(), staging.size() * sizeof(float));
+    }
+    // the draw records stay alive until the callbacks of this frame ran
+    staging.clear();
+    uploaded = true;
+}
+
+void PlotRenderer::discard() {
+    // the draw records go with the next plot(), like after an upload
+    staging.clear();
+    uploaded = true;
+}
+
+void PlotRenderer::draw(const Draw &d, const ImDrawCmd *cmd) const {
+    const ImVec2 disp_size = ImGui::GetIO().DisplaySize;
+    plot_params_t params = {};
+    for (int i = 0; i < 4; i++) {
+        params.rect[i]  = d.rect[i];
+        params.range[i] = d.range[i];
+        params.color[i] = d.color[i];
+    }
+    params.disp_size[0] = disp_size.x;
+    params.disp_size[1] = disp_size.y;
+    params.thickness    = d.thickness;
+    params.mode         = d.points ? 1.0f : 0.0f;
+
+    const int num_instances = d.points ? d.num_points : d.num_points - 1;
+    if ((num_instances <= 0) || !PipelineCache::is_ready(pip)) {
+        return;
+    }
+    const int stride              = 2 * sizeof(float);
+    sg_bindings bind              = {};
+    const int first               = int(ring_offset) + d.first_point * stride;
+    bind.vertex_buffers[0]        = ring->get_buffer();
+    bind.vertex_buffers[1]        = ring->get_buffer();
+    bind.vertex_buffer_offsets[0] = first;
+    bind.vertex_buffer_offsets[1] = first + (d.points ? 0 : stride);
+    sg_apply_pipeline(pip);
+    sg_apply_bindings(&bind);
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_plot_params, SG_RANGE(params));
+    sg_apply_scissor_rect((int)cmd->ClipRect.x, (int)cmd->ClipRect.y,
+                          (int)(cmd->ClipRect.z - cmd->ClipRect.x),
+                          (int)(cmd->ClipRect.w - cmd->ClipRect.y), true);
+    sg_draw(0, 6, num_instances);
+}
+
+void PlotRenderer::draw_callback(const ImDrawList *list, const ImDrawCmd *cmd) {
+    (void)list;
+    const Draw *d = (const Draw *)cmd->UserCallbackData;
+    d->renderer->draw(*d, cmd);
+}
+
+} // namespace simly
@@ -0,0 +1,94 @@
+#ifndef __PLOT_HPP__
+#define __PLOT_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "frame_ring.hpp"
+#include "imgui.h"
+#include "sokol_gfx.h"
+
+namespace simly {
+
+// One data series of a plot. x must be sorted ascending.
+struct PlotSeries {
+    const float *x  = {};
+    const float *y  = {};
+    size_t count    = {};
+    ImU32 color     = IM_COL32(255, 255, 255, 255);
+    float thickness = 1.0f;
+    bool points     = false;
+};
+
+// Draws large sample columns on the GPU instead of through ImDrawList
+// polylines. Visible samples are reduced on the CPU to the min and max of
+// every pixel column, all plots of a frame go into one range of the frame
+// ring, and the vertex shader expands every segment (or point) into a quad
+// from two instanced reads of that range.
+//
+// Usage per frame: plot() while building the UI, upload() after
+// ImGui::Render() and before the ring is committed, the draws then happen
+// from ImGui draw callbacks inside the pass.
+class PlotRenderer {
+  private:
+    struct Draw {
+        PlotRenderer *renderer = {};
+        int first_point        = {};
+        int num_points         = {};
+        float rect[4]          = {};
+        float range[4]         = {};
+        float color[4]         = {};
+        float thickness        = {};
+        bool points            = {};
+    };
+
+    FrameRing *ring     = {};
+    sg_pipeline pip     = {};
+    size_t ring_offset  = 0;
+    int uploaded_points = 0;
+    // set by upload(), the draw records of the previous frame are dropped
+    // with the first plot() of the next one
+    bool uploaded = false;
+    // content of the last upload, see changed()
+    uint64_t uploaded_key = 0;
+    std::vector<float> staging;
+    std::deque<Draw> draws;
+
+    size_t append_decimated(const PlotSeries &s, float x_min, float x_max,
+                            int columns);
+    void draw(const Draw &d, const ImDrawCmd *cmd) const;
+    static void draw_callback(const ImDrawList *list, const ImDrawCmd *cmd);
+    int get_num_points() const { return int(staging.size() / 2); }
+    uint64_t content_key() const;
+
+  public:
+    // samples are uploaded through `vertex_ring`, a vertex buffer ring
+    void init(FrameRing &vertex_ring);
+
+    // Adds a plot covering the rectangle [pos, pos + size] of the draw
+    // list, mapping [x_min, x_max] x [y_min, y_max] onto it.
+    void plot(ImDrawList *dl, ImVec2 pos, ImVec2 size,
+              const PlotSeries *series, int num_series, float x_min,
+              float x_max, float y_min, float y_max);
+
+    // Copies the samples of all plots added this frame into the ring. Must
+    // be called between FrameRing::begin_frame() and commit().
+    void upload();
+
+    // true if the plots added this frame differ from the last upload, in
+    // their samples or in where and how they are drawn
+    bool changed() const { return content_key() != uploaded_key; }
+
+    // Drops the plots added this frame, instead of upload() for a frame
+    // that isn't rendered.
+    void discard();
+
+    // number of points of the last upload, after decimation
+    int get_uploaded_points() const { return uploaded_points; }
+};
+
+} // namespace simly
+
+#endif // __PLOT_HPP__
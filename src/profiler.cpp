@@ -0,0 +1,208 @@
+//------------------------------------------------------------------------------
+//  profiler.cpp
+//
+//  CPU scope timers, the timeline panel and the Chrome trace export.
+//------------------------------------------------------------------------------
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "imgui.h"
+#include "sokol_time.h"
+
+namespace simly {
+
+// the calling thread's ring, created on its first scope
+static thread_local Profiler *tls_owner   = nullptr;
+static thread_local ProfileRing *tls_ring = nullptr;
+
+ProfileRing &Profiler::thread_ring() {
+    if (tls_owner != this) {
+        std::lock_guard<std::mutex> lock(mutex);
+        rings.emplace_back(
+            new ProfileRing(unsigned(rings.size()), RingCapacity));
+        tls_owner = this;
+        tls_ring  = rings.back().get();
+    }
+    return *tls_ring;
+}
+
+void Profiler::begin(const char *name) { thread_ring().begin(name, stm_now()); }
+
+void Profiler::end() { thread_ring().end(stm_now()); }
+
+void Profiler::record(const char *name, uint64_t start, uint64_t end) {
+    if (is_enabled()) {
+        ProfileRing &ring = thread_ring();
+        ring.push(name, start, end, ring.get_depth());
+    }
+}
+
+void Profiler::frame() {
+    const uint64_t now = stm_now();
+    if ((num_frames > 0) && !paused && is_enabled()) {
+        snapshot(frame_starts[(num_frames - 1) % MaxFrames], now);
+    }
+    frame_starts[num_frames % MaxFrames] = now;
+    num_frames++;
+}
+
+// copy the events of all threads that overlap [start, end), rings are
+// ordered by end time, so each one is scanned backwards
+void Profiler::snapshot(uint64_t start, uint64_t end) {
+    std::lock_guard<std::mutex> lock(mutex);
+    shown.clear();
+    shown_threads.clear();
+    for (const std::unique_ptr<ProfileRing> &ring : rings) {
+        const uint64_t count = ring->get_count();
+        const uint64_t kept  = std::min<uint64_t>(count, ring->get_capacity());
+        for (uint64_t i = 0; i < kept; i++) {
+            const ProfileEvent &ev = ring->get(count - 1 - i);
+            if (ev.end < start) {
+                break;
+            }
+            if (ev.start < end) {
+                shown.push_back(ev);
+                shown_threads.push_back(ring->thread_index);
+            }
+        }
+    }
+    shown_start = start;
+    shown_end   = end;
+}
+
+static ImU32 scope_color(const char *name) {
+    // stable color per scope name
+    uint32_t h = 2166136261u;
+    for (const char *c = name; *c; c++) {
+        h = (h ^ uint8_t(*c)) * 16777619u;
+    }
+    return IM_COL32(96 + (h & 0x7F), 96 + ((h >> 8) & 0x7F),
+                    96 + ((h >> 16) & 0x7F), 255);
+}
+
+void Profiler::draw_panel(bool *open) {
+    if (!ImGui::Begin("Profiler", open)) {
+        ImGui::End();
+        return;
+    }
+    bool on = is_enabled();
+    if (ImGui::Checkbox("enabled", &on)) {
+        set_enabled(on);
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("pause", &paused);
+    ImGui::SameLine();
+    if (ImGui::Button("export trace")) {
+        export_result = export_chrome_trace(trace_path) ? 1 : 0;
+    }
+    if (export_result >= 0) {
+        ImGui::SameLine();
+        ImGui::Text("%s %s", export_result ? "wrote" : "failed to write",
+                    trace_path);
+    }
+
+    const double frame_ms = stm_ms(shown_end - shown_start);
+    ImGui::Text("frame %.2f ms, %d scopes", frame_ms, (int)shown.size());
+
+    unsigned num_threads = 0;
+    uint32_t max_depth   = 0;
+    for (size_t i = 0; i < shown.size(); i++) {
+        num_threads = std::max(num_threads, shown_threads[i] + 1);
+        max_depth   = std::max(max_depth, shown[i].depth);
+    }
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float width   = ImGui::GetContentRegionAvail().x;
+    const float bar_h   = ImGui::GetTextLineHeight() + 2.0f;
+    const float row_h   = bar_h * float(max_depth + 1) + 4.0f;
+    const float height  = row_h * float(num_threads);
+    if ((width < 1.0f) || (num_threads == 0) || (shown_end <= shown_start)) {
+        ImGui::End();
+        return;
+    }
+
+    // one row per thread, nested scopes stacked below their parent
+    ImDrawList *dl              = ImGui::GetWindowDrawList();
+    const double scale          = double(width) / (shown_end - shown_start);
+    const ImVec2 mouse          = ImGui::GetMousePos();
+    const ProfileEvent *hovered = nullptr;
+    dl->PushClipRect(origin, ImVec2(origin.x + width, origin.y + height),
+                     true);
+    for (size_t i = 0; i < shown.size(); i++) {
+        const ProfileEvent &ev = shown[i];
+        const uint64_t t0      = std::max(ev.start, shown_start) - shown_start;
+        const uint64_t t1      = std::min(ev.end, shown_end) - shown_start;
+        const ImVec2 p0(origin.x + float(t0 * scale),
+                        origin.y + row_h * float(shown_threads[i]) +
+                            bar_h * float(ev.depth));
+        const ImVec2 p1(std::max(p0.x + 1.0f, origin.x + float(t1 * scale)),
+                        p0.y + bar_h - 1.0f);
+        dl->AddRectFilled(p0, p1, scope_color(ev.name));
+        if ((p1.x - p0.x) > ImGui::CalcTextSize(ev.name).x + 4.0f) {
+            dl->AddText(ImVec2(p0.x + 2.0f, p0.y + 1.0f),
+                        IM_COL32(0, 0, 0, 255), ev.name);
+        }
+        if ((mouse.x >= p0.x) && (mouse.x < p1.x) && (mouse.y >= p0.y) &&
+            (mouse.y < p1.y)) {
+            hovered = &ev;
+        }
+    }
+    dl->PopClipRect();
+    ImGui::Dummy(ImVec2(width, height));
+    if (hovered && ImGui::IsWindowHovered()) {
+        ImGui::SetTooltip("%s: %.3f ms", hovered->name,
+                          stm_ms(hovered->end - hovered->start));
+    }
+    ImGui::End();
+}
+
+// a JSON string literal, scope names are free-form text
+static void write_json_string(FILE *fp, const char *str) {
+    fputc('"', fp);
+    for (const char *c = str; *c; c++) {
+        const unsigned char ch = (unsigned char)*c;
+        if ((ch == '"') || (ch == '\\')) {
+            fputc('\\', fp);
+            fputc(ch, fp);
+        } else if (ch < 0x20) {
+            fprintf(fp, "\\u%04x", ch);
+        } else {
+            fputc(ch, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+// everything still in the rings, as complete ("X") events in microseconds
+bool Profiler::export_chrome_trace(const char *path) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    fprintf(fp, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (const std::unique_ptr<ProfileRing> &ring : rings) {
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                    "\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}",
+                first ? "" : ",\n", ring->thread_index, ring->thread_index);
+        first                = false;
+        const uint64_t count = ring->get_count();
+        const uint64_t kept  = std::min<uint64_t>(count, ring->get_capacity());
+        for (uint64_t i = count - kept; i < count; i++) {
+            const ProfileEvent &ev = ring->get(i);
+            fprintf(fp, ",\n{\"name\":");
+            write_json_string(fp, ev.name);
+            fprintf(fp,
+                    ",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,"
+                    "\"dur\":%.3f}",
+                    ring->thread_index, stm_us(ev.start),
+                    stm_us(ev.end - ev.start));
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    return fclose(fp) == 0;
+}
+
+} // namespace simly
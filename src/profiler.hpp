@@ -0,0 +1,169 @@
+#ifndef __PROFILER_HPP__
+#define __PROFILER_HPP__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace simly {
+
+// One finished scope, times in sokol_time ticks.
+struct ProfileEvent {
+    const char *name = {};
+    uint64_t start   = 0;
+    uint64_t end     = 0;
+    uint32_t depth   = 0;
+};
+
+// Events of one thread. Only the owning thread writes; the others may read
+// what was recorded up to get_count() while the owner isn't recording
+// (e.g. between frames, when the pool workers are idle).
+class ProfileRing {
+  private:
+    struct Open {
+        const char *name;
+        uint64_t start;
+    };
+    static const int MaxDepth = 32;
+
+    std::vector<ProfileEvent> events;
+    std::atomic<uint64_t> count{0};
+    Open stack[MaxDepth] = {};
+    int depth            = 0;
+
+  public:
+    const unsigned thread_index;
+
+    ProfileRing(unsigned index, size_t capacity)
+        : events(capacity), thread_index(index) {}
+
+    void begin(const char *name, uint64_t now) {
+        if (depth < MaxDepth) {
+            stack[depth] = {name, now};
+        }
+        depth++;
+    }
+
+    void end(uint64_t now) {
+        depth--;
+        if ((depth < 0) || (depth >= MaxDepth)) {
+            // unbalanced or too deep, drop the scope
+            depth = (depth < 0) ? 0 : depth;
+            return;
+        }
+        push(stack[depth].name, stack[depth].start, now, depth);
+    }
+
+    void push(const char *name, uint64_t start, uint64_t end, int at_depth) {
+        const uint64_t n = count.load(std::memory_order_relaxed);
+        ProfileEvent &ev = events[n % events.size()];
+        ev.name          = name;
+        ev.start         = start;
+        ev.end           = end;
+        ev.depth         = uint32_t(at_depth);
+        count.store(n + 1, std::memory_order_release);
+    }
+
+    int get_depth() const { return depth; }
+
+    // total number of events recorded, the last get_capacity() are kept
+    uint64_t get_count() const {
+        return count.load(std::memory_order_acquire);
+    }
+    size_t get_capacity() const { return events.size(); }
+    const ProfileEvent &get(uint64_t i) const {
+        return events[i % events.size()];
+    }
+};
+
+// CPU scope timers based on sokol_time, cheap enough to stay in release
+// builds: a disabled profiler costs one relaxed atomic load per scope, an
+// enabled one two stm_now() calls and a store into the calling thread's
+// ring. Names must be string literals (or otherwise outlive the profiler).
+//
+// The timeline panel shows the last completed frame (between the last two
+// frame() calls) per thread; export_chrome_trace() writes everything still
+// in the rings in the Chrome trace event format (chrome://tracing,
+// ui.perfetto.dev).
+class Profiler {
+  private:
+    static const size_t RingCapacity = 16 * 1024;
+    static const int MaxFrames       = 256;
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ProfileRing>> rings;
+    std::atomic<bool> enabled{true};
+    uint64_t frame_starts[MaxFrames] = {};
+    uint64_t num_frames              = 0;
+    // the frame shown in the panel, frozen while paused
+    std::vector<ProfileEvent> shown;
+    std::vector<unsigned> shown_threads;
+    uint64_t shown_start = 0;
+    uint64_t shown_end   = 0;
+    bool paused          = false;
+    // target of the panel's export button and the result of the last
+    // export, -1 before the first one
+    const char *trace_path = "simly_trace.json";
+    int export_result      = -1;
+
+    ProfileRing &thread_ring();
+    void snapshot(uint64_t start, uint64_t end);
+
+  public:
+    void begin(const char *name);
+    void end();
+    // a span timed by the caller, nested in the currently open scope
+    void record(const char *name, uint64_t start, uint64_t end);
+
+    // marks the start of a frame, call first thing on the main thread
+    void frame();
+
+    void set_enabled(bool on) {
+        enabled.store(on, std::memory_order_relaxed);
+    }
+    bool is_enabled() const {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // ImGui window with a per-thread timeline of the last frame, the caller
+    // sets its initial position and size
+    void draw_panel(bool *open);
+    bool export_chrome_trace(const char *path);
+};
+
+// Process-wide profiler used by SIMLY_PROFILE_SCOPE.
+inline Profiler &default_profiler() {
+    static Profiler profiler;
+    return profiler;
+}
+
+class ProfileScope {
+  private:
+    bool active;
+
+  public:
+    explicit ProfileScope(const char *name)
+        : active(default_profiler().is_enabled()) {
+        if (active)
+            default_profiler().begin(name);
+    }
+    ~ProfileScope() {
+        if (active)
+            default_profiler().end();
+    }
+    ProfileScope(const ProfileScope &)            = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+};
+
+#define SIMLY_PROFILE_CONCAT2(a, b) a##b
+#define SIMLY_PROFILE_CONCAT(a, b) SIMLY_PROFILE_CONCAT2(a, b)
+// times the rest of the enclosing block
+#define SIMLY_PROFILE_SCOPE(name)                                              \
+    simly::ProfileScope SIMLY_PROFILE_CONCAT(profile_scope_, __LINE__)(name)
+
+} // namespace simly
+
+#endif // __PROFILER_HPP__
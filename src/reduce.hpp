@@ -0,0 +1,235 @@
+#ifndef __REDUCE_HPP__
+#define __REDUCE_HPP__
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+#include "arena.hpp"
+#include "parallel.hpp"
+
+namespace simly {
+
+// Reductions, scans and stream compaction over entity columns.
+//
+// Work is split into fixed-size chunks whose boundaries depend only on the
+// element count, never on the number of threads. Each chunk is reduced with
+// a fixed number of independent lane accumulators, each folding its own
+// contiguous block, so several dependency chains are in flight at once.
+// Lane and chunk partials are combined serially in index order, which keeps
+// the result exact for non-commutative ops and bit-identical for any pool
+// size. Scratch space comes from the calling thread's frame arena.
+
+static const size_t ReduceChunk = 16 * 1024;
+static const size_t ReduceLanes = 8;
+
+namespace detail {
+
+inline size_t num_chunks(size_t n) {
+    return (n + ReduceChunk - 1) / ReduceChunk;
+}
+
+// Lane l folds [l * span, (l + 1) * span), the lanes advance in lockstep.
+// The lanes and then the leftover tail are combined in index order.
+template <typename T, typename Op>
+T reduce_lanes(const T *p, size_t n, T identity, const Op &op) {
+    const size_t span = n / ReduceLanes;
+    T acc[ReduceLanes];
+    for (size_t l = 0; l < ReduceLanes; l++)
+        acc[l] = identity;
+    for (size_t i = 0; i < span; i++)
+        for (size_t l = 0; l < ReduceLanes; l++)
+            acc[l] = op(acc[l], p[l * span + i]);
+    T result = identity;
+    for (size_t l = 0; l < ReduceLanes; l++)
+        result = op(result, acc[l]);
+    for (size_t i = span * ReduceLanes; i < n; i++)
+        result = op(result, p[i]);
+    return result;
+}
+
+// Runs fn(chunk_index, begin, end) for every chunk of [0, n).
+template <typename F>
+void for_each_chunk(size_t n, ThreadPool &pool, const F &fn) {
+    pool.parallel_for(num_chunks(n), 1,
+                      [&](size_t cb, size_t ce, unsigned) {
+                          for (size_t c = cb; c < ce; c++)
+                              fn(c, c * ReduceChunk,
+                                 std::min(n, (c + 1) * ReduceChunk));
+                      });
+}
+
+} // namespace detail
+
+// Generic deterministic reduction. `op` must be associative; it does not
+// need to be commutative.
+template <typename T, typename Op>
+T reduce(const T *data, size_t n, T identity, const Op &op,
+         ThreadPool &pool = default_pool()) {
+    if (n <= ReduceChunk)
+        return detail::reduce_lanes(data, n, identity, op);
+    const size_t chunks = detail::num_chunks(n);
+    T *partial          = FrameArena::current().allocate_array<T>(chunks);
+    detail::for_each_chunk(n, pool, [&](size_t c, size_t b, size_t e) {
+        partial[c] = detail::reduce_lanes(data + b, e - b, identity, op);
+    });
+    T result = identity;
+    for (size_t c = 0; c < chunks; c++)
+        result = op(result, partial[c]);
+    return result;
+}
+
+template <typename T>
+T reduce_sum(const T *data, size_t n, ThreadPool &pool = default_pool()) {
+    return reduce(data, n, T(0), std::plus<T>(), pool);
+}
+
+template <typename T>
+T reduce_min(const T *data, size_t n, ThreadPool &pool = default_pool()) {
+    return reduce(
+        data, n, std::numeric_limits<T>::max(),
+        [](T a, T b) { return b < a ? b : a; }, pool);
+}
+
+template <typename T>
+T reduce_max(const T *data, size_t n, ThreadPool &pool = default_pool()) {
+    return reduce(
+        data, n, std::numeric_limits<T>::lowest(),
+        [](T a, T b) { return a < b ? b : a; }, pool);
+}
+
+// Number of elements for which pred(x) holds.
+template <typename T, typename Pred>
+size_t count_if(const T *data, size_t n, const Pred &pred,
+                ThreadPool &pool = default_pool()) {
+    const size_t chunks = std::max<size_t>(detail::num_chunks(n), 1);
+    size_t *partial     = FrameArena::current().allocate_array<size_t>(chunks);
+    std::fill(partial, partial + chunks, 0);
+    detail::for_each_chunk(n, pool, [&](size_t c, size_t b, size_t e) {
+        size_t count = 0;
+        for (size_t i = b; i < e; i++)
+            count += pred(data[i]) ? 1 : 0;
+        partial[c] = count;
+    });
+    size_t total = 0;
+    for (size_t c = 0; c < chunks; c++)
+        total += partial[c];
+    return total;
+}
+
+// Accumulates values into `num_bins` equal-width bins over [lo, hi).
+// Out-of-range values are clamped to the edge bins, NaNs are dropped.
+// `bins` is overwritten.
+inline void histogram(const float *data, size_t n, float lo, float hi,
+                      uint32_t *bins, size_t num_bins,
+                      ThreadPool &pool = default_pool()) {
+    assert(num_bins > 0 && hi > lo);
+    const size_t chunks = std::max<size_t>(detail::num_chunks(n), 1);
+    uint32_t *local =
+        FrameArena::current().allocate_array<uint32_t>(chunks * num_bins);
+    std::memset(local, 0, sizeof(uint32_t) * chunks * num_bins);
+    const float scale = float(num_bins) / (hi - lo);
+    detail::for_each_chunk(n, pool, [&](size_t c, size_t b, size_t e) {
+        uint32_t *h = local + c * num_bins;
+        for (size_t i = b; i < e; i++) {
+            const float x = data[i];
+            if (x != x)
+                continue;
+            float f = (x - lo) * scale;
+            f       = std::min(std::max(f, 0.0f), float(num_bins - 1));
+            h[size_t(f)]++;
+        }
+    });
+    std::memset(bins, 0, sizeof(uint32_t) * num_bins);
+    for (size_t c = 0; c < chunks; c++)
+        for (size_t k = 0; k < num_bins; k++)
+            bins[k] += local[c * num_bins + k];
+}
+
+// Exclusive prefix sum: out[i] = in[0] + ... + in[i-1]. Returns the total.
+// `out` may alias `in`.
+template <typename T>
+T exclusive_scan(const T *in, T *out, size_t n,
+                 ThreadPool &pool = default_pool()) {
+    const size_t chunks = std::max<size_t>(detail::num_chunks(n), 1);
+    T *offset           = FrameArena::current().allocate_array<T>(chunks);
+    std::fill(offset, offset + chunks, T(0));
+    detail::for_each_chunk(n, pool, [&](size_t c, size_t b, size_t e) {
+        T sum = T(0);
+        for (size_t i = b; i < e; i++)
+            sum += in[i];
+        offset[c] = sum;
+    });
+    T total = T(0);
+    for (size_t c = 0; c < chunks; c++) {
+        const T sum = offset[c];
+        offset[c]   = total;
+        total += sum;
+    }
+    detail::for_each_chunk(n, pool, [&](size_t c, size_t b, size_t e) {
+        T running = offset[c];
+        for (size_t i = b; i < e; i++) {
+            const T v = in[i];
+            out[i]    = running;
+            running += v;
+        }
+    });
+    return total;
+}
+
+// Stable stream compaction: writes the indices i with keep[i] != 0 to
+// `out_indices` in ascending order and returns how many were written.
+// `out_indices` must have room for n entries.
+inline size_t compact_indices(const uint8_t *keep, size_t n,
+                              uint32_t *out_indices,
+                              ThreadPool &pool = default_pool()) {
+    const size_t chunks = std::max<size_t>(detail::num_chunks(n), 1);
+    size_t *offset      = FrameArena::current().allocate_array<size_t>(chunks);
+    std::fill(offset, offset + chunks, 0);
+    detail::for_each_chunk(n, pool, [&](size_t c, size_t b, size_t e) {
+        size_t count = 0;
+        for (size_t i = b; i < e; i++)
+            count += keep[i] ? 1 : 0;
+        offset[c] = count;
+    });
+    size_t total = exclusive_scan(offset, offset, chunks, pool);
+    detail::for_each_chunk(n, pool, [&](size_t c, size_t b, size_t e) {
+        uint32_t *dst = out_indices + offset[c];
+        for (size_t i = b; i < e; i++)
+            if (keep[i])
+                *dst++ = uint32_t(i);
+    });
+    return total;
+}
+
+// Stable stream compaction of a column: copies the kept elements of `in`
+// to the front of `out`, preserving order. `out` must not alias `in`.
+template <typename T>
+size_t compact(const T *in, const uint8_t *keep, size_t n, T *out,
+               ThreadPool &pool = default_pool()) {
+    const size_t chunks = std::max<size_t>(detail::num_chunks(n), 1);
+    size_t *offset      = FrameArena::current().allocate_array<size_t>(chunks);
+    std::fill(offset, offset + chunks, 0);
+    detail::for_each_chunk(n, pool, [&](size_t c, size_t b, size_t e) {
+        size_t count = 0;
+        for (size_t i = b; i < e; i++)
+            count += keep[i] ? 1 : 0;
+        offset[c] = count;
+    });
+    size_t total = exclusive_scan(offset, offset, chunks, pool);
+    detail::for_each_chunk(n, pool, [&](size_t c, size_t b, size_t e) {
+        T *dst = out + offset[c];
+        for (size_t i = b; i < e; i++)
+            if (keep[i])
+                *dst++ = in[i];
+    });
+    return total;
+}
+
+} // namespace simly
+
+#endif // __REDUCE_HPP__
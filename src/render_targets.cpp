@@ -0,0 +1,106 @@
+//------------------------------------------------------------------------------
+//  render_targets.cpp
+//
+//  Pooled and aliased offscreen render targets.
+//------------------------------------------------------------------------------
+#include "render_targets.hpp"
+
+#include <cassert>
+
+namespace simly {
+
+size_t RenderTargetPool::bytes_per_pixel(sg_pixel_format format) {
+    switch (format) {
+    case SG_PIXELFORMAT_R8:
+        return 1;
+    case SG_PIXELFORMAT_RGBA16F:
+        return 8;
+    case SG_PIXELFORMAT_RGBA32F:
+        return 16;
+    default:
+        // RGBA8, BGRA8, DEPTH, DEPTH_STENCIL
+        return 4;
+    }
+}
+
+sg_image RenderTargetPool::acquire(int width, int height,
+                                   sg_pixel_format format, int sample_count,
+                                   bool shared, const char *label) {
+    assert((width > 0) && (height > 0) && (sample_count > 0));
+    for (Entry &e : entries) {
+        if ((e.width == width) && (e.height == height) &&
+            (e.format == format) && (e.sample_count == sample_count) &&
+            (e.shared == shared) && (shared || (e.refs == 0))) {
+            e.refs++;
+            e.last_used = frame;
+            return e.img;
+        }
+    }
+
+    sg_image_desc desc = {};
+    desc.render_target = true;
+    desc.width         = width;
+    desc.height        = height;
+    desc.pixel_format  = format;
+    desc.sample_count  = sample_count;
+    desc.label         = label;
+
+    Entry e        = {};
+    e.img          = sg_make_image(&desc);
+    e.width        = width;
+    e.height       = height;
+    e.format       = format;
+    e.sample_count = sample_count;
+    e.shared       = shared;
+    e.refs         = 1;
+    e.last_used    = frame;
+    entries.push_back(e);
+    return e.img;
+}
+
+void RenderTargetPool::release(sg_image img) {
+    if (img.id == SG_INVALID_ID) {
+        return;
+    }
+    for (Entry &e : entries) {
+        if (e.img.id == img.id) {
+            assert(e.refs > 0);
+            e.refs--;
+            e.last_used = frame;
+            return;
+        }
+    }
+    assert(false && "image not from this pool");
+}
+
+void RenderTargetPool::update() {
+    frame++;
+    for (size_t i = 0; i < entries.size();) {
+        const Entry &e = entries[i];
+        if ((e.refs == 0) && ((frame - e.last_used) > max_idle_frames)) {
+            sg_destroy_image(e.img);
+            entries[i] = entries.back();
+            entries.pop_back();
+        } else {
+            i++;
+        }
+    }
+}
+
+void RenderTargetPool::shutdown() {
+    for (const Entry &e : entries) {
+        sg_destroy_image(e.img);
+    }
+    entries.clear();
+}
+
+size_t RenderTargetPool::get_num_bytes() const {
+    size_t bytes = 0;
+    for (const Entry &e : entries) {
+        bytes += size_t(e.width) * size_t(e.height) *
+                 size_t(e.sample_count) * bytes_per_pixel(e.format);
+    }
+    return bytes;
+}
+
+} // namespace simly
@@ -0,0 +1,66 @@
+#ifndef __RENDER_TARGETS_HPP__
+#define __RENDER_TARGETS_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "sokol_gfx.h"
+
+namespace simly {
+
+// Pool of render target images keyed by size, pixel format and sample
+// count.
+//
+// Transient targets (MSAA color, depth-stencil) only hold data during the
+// pass that renders into them. Offscreen passes run one after another, so
+// their lifetimes never overlap and all passes with the same key alias a
+// single image: acquire(..., true) hands out the same image to every
+// caller. Targets that outlive their pass (e.g. a resolve image sampled by
+// the UI) are acquired exclusively.
+//
+// Released images stay in the pool for `max_idle_frames` frames, so a view
+// switching back and forth between sizes doesn't recreate its targets.
+class RenderTargetPool {
+  private:
+    struct Entry {
+        sg_image img           = {};
+        int width              = 0;
+        int height             = 0;
+        sg_pixel_format format = {};
+        int sample_count       = 0;
+        bool shared            = false;
+        int refs               = 0;
+        uint64_t last_used     = 0;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t frame = 0;
+
+    static size_t bytes_per_pixel(sg_pixel_format format);
+
+  public:
+    uint64_t max_idle_frames = 120;
+
+    sg_image acquire(int width, int height, sg_pixel_format format,
+                     int sample_count, bool shared, const char *label = 0);
+    void release(sg_image img);
+
+    // Once per frame, destroys the images unused for max_idle_frames.
+    void update();
+    void shutdown();
+
+    size_t get_num_images() const { return entries.size(); }
+    // approximate GPU memory of all pooled images
+    size_t get_num_bytes() const;
+};
+
+// Process-wide pool used by the offscreen views.
+inline RenderTargetPool &default_render_targets() {
+    static RenderTargetPool pool;
+    return pool;
+}
+
+} // namespace simly
+
+#endif // __RENDER_TARGETS_HPP__
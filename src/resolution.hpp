@@ -0,0 +1,94 @@
+#ifndef __RESOLUTION_HPP__
+#define __RESOLUTION_HPP__
+
+#include <algorithm>
+
+namespace simly {
+
+// Dynamic resolution controller for the 3D views. Fed once per frame with
+// the CPU time of the last frame, the measured frame interval and the
+// interval frames are paced at (wgpu_frame_budget(): the frame rate cap or
+// the display interval), it picks a render scale in steps of `step` so the
+// frame fits that budget. Unpaced frames (no vsync, no cap) use `target_ms`.
+//
+// With vsync the frame interval sits at the display interval while the
+// frame fits and jumps to a multiple of it when it doesn't, so it tells
+// when to go down but not how much headroom there is. The scale therefore
+// drops fast (one step per `settle_frames`) and only creeps back up after
+// `raise_frames` frames in budget; a raise that misses the budget again
+// doubles the wait before the next one.
+class ResolutionScaler {
+  private:
+    float scale    = 1.0f;
+    double avg_cpu = 0.0;
+    double avg_dt  = 0.0;
+    int cooldown   = 0;
+    int in_budget  = 0;
+    int raise_wait = 0;
+    bool raised    = false;
+
+    static double ema(double avg, double val) {
+        return (avg == 0.0) ? val : (avg + 0.1 * (val - avg));
+    }
+
+  public:
+    double target_ms  = 1000.0 / 60.0;
+    float min_scale   = 0.5f;
+    float max_scale   = 1.0f;
+    float step        = 0.0625f;
+    int settle_frames = 15;
+    int raise_frames  = 120;
+    bool enabled      = true;
+
+    // Returns the scale for the coming frame, frame_ms is the CPU time of
+    // the last frame, interval_ms the time between the last two frames and
+    // budget_ms the paced frame interval, 0 if frames aren't paced.
+    float update(double frame_ms, double interval_ms, double budget_ms) {
+        avg_cpu = ema(avg_cpu, frame_ms);
+        avg_dt  = ema(avg_dt, interval_ms);
+        if (!enabled) {
+            scale = max_scale;
+            return scale;
+        }
+        if (cooldown > 0) {
+            cooldown--;
+            return scale;
+        }
+        if (raise_wait == 0) {
+            raise_wait = raise_frames;
+        }
+        const double budget = (budget_ms > 0.0) ? budget_ms : target_ms;
+        const bool over     = (avg_dt > budget * 1.2) || (avg_cpu > budget);
+        if (over) {
+            if (raised) {
+                // the last raise didn't fit, back off for longer
+                raise_wait = std::min(raise_wait * 2, raise_frames * 16);
+            }
+            scale     = std::max(scale - step, min_scale);
+            cooldown  = settle_frames;
+            in_budget = 0;
+            raised    = false;
+        } else {
+            in_budget = std::min(in_budget + 1, raise_wait);
+            if (raised && (in_budget > settle_frames)) {
+                // the last raise held
+                raise_wait = raise_frames;
+                raised     = false;
+            }
+            if ((in_budget >= raise_wait) && (scale < max_scale)) {
+                scale     = std::min(scale + step, max_scale);
+                cooldown  = settle_frames;
+                in_budget = 0;
+                raised    = true;
+            }
+        }
+        return scale;
+    }
+
+    float get_scale() const { return scale; }
+    double get_avg_frame_ms() const { return avg_cpu; }
+};
+
+} // namespace simly
+
+#endif // __RESOLUTION_HPP__
@@ -0,0 +1,158 @@
+//------------------------------------------------------------------------------
+//  shaders.glsl
+//
+//  All shaders of simly_app, compiled to the target shader language at build
+//  time by sokol-shdc (see sokol_shader() in CMakeLists.txt).
+//------------------------------------------------------------------------------
+
+//--- ImGui
+@vs imgui_vs
+uniform imgui_params {
+    vec2 disp_size;
+};
+
+in vec2 pos;
+in vec2 texcoord0;
+in vec4 color0;
+
+out vec2 uv;
+out vec4 color;
+
+void main() {
+    gl_Position = vec4(((pos / disp_size) - 0.5) * vec2(2.0, -2.0), 0.5, 1.0);
+    uv = texcoord0;
+    color = color0;
+}
+@end
+
+@fs imgui_fs
+uniform texture2D tex;
+uniform sampler smp;
+
+in vec2 uv;
+in vec4 color;
+
+out vec4 frag_color;
+
+void main() {
+    frag_color = texture(sampler2D(tex, smp), uv) * color;
+}
+@end
+
+// the font atlas is single-channel coverage
+@fs imgui_font_fs
+uniform texture2D tex;
+uniform sampler smp;
+
+in vec2 uv;
+in vec4 color;
+
+out vec4 frag_color;
+
+void main() {
+    frag_color = vec4(1.0, 1.0, 1.0, texture(sampler2D(tex, smp), uv).r) * color;
+}
+@end
+
+@program imgui imgui_vs imgui_fs
+@program imgui_font imgui_vs imgui_font_fs
+
+//--- GPU plots: every instance is one segment p0->p1 (or one point with
+//    p0 == p1), expanded to a screen-space quad of `thickness` pixels
+@vs plot_vs
+uniform plot_params {
+    vec4 rect;
+    vec4 range;
+    vec4 color;
+    vec2 disp_size;
+    float thickness;
+    float mode;
+};
+
+in vec2 p0;
+in vec2 p1;
+
+out vec4 v_color;
+
+const vec2 corners[6] = vec2[6](
+    vec2(0.0, -1.0), vec2(0.0, 1.0), vec2(1.0, -1.0),
+    vec2(1.0, -1.0), vec2(0.0, 1.0), vec2(1.0, 1.0));
+
+vec2 to_px(vec2 p) {
+    vec2 t = (p - range.xz) / (range.yw - range.xz);
+    return vec2(mix(rect.x, rect.z, t.x), mix(rect.w, rect.y, t.y));
+}
+
+void main() {
+    vec2 c = corners[gl_VertexIndex];
+    vec2 a = to_px(p0);
+    vec2 b = to_px(p1);
+    vec2 d = b - a;
+    float len = length(d);
+    vec2 dir = (len > 1e-6) ? (d / len) : vec2(1.0, 0.0);
+    float half_width = thickness * 0.5;
+    vec2 px = mix(a, b, c.x) + vec2(-dir.y, dir.x) * half_width * c.y;
+    if (mode > 0.5) {
+        px += dir * half_width * (c.x * 2.0 - 1.0);
+    }
+    gl_Position = vec4(((px / disp_size) - 0.5) * vec2(2.0, -2.0), 0.5, 1.0);
+    v_color = color;
+}
+@end
+
+@fs plot_fs
+in vec4 v_color;
+
+out vec4 frag_color;
+
+void main() {
+    frag_color = v_color;
+}
+@end
+
+@program plot plot_vs plot_fs
+
+//--- entities: camera-facing discs, one instance per entity
+@vs entity_vs
+uniform entity_params {
+    mat4 view_proj;
+    vec4 right;
+    vec4 up;
+};
+
+in vec3 pos;
+in float scale;
+in vec4 color0;
+
+out vec2 uv;
+out vec4 color;
+
+const vec2 corners[6] = vec2[6](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0));
+
+void main() {
+    vec2 c = corners[gl_VertexIndex];
+    vec3 world = pos + (right.xyz * c.x + up.xyz * c.y) * scale;
+    gl_Position = view_proj * vec4(world, 1.0);
+    uv = c;
+    color = color0;
+}
+@end
+
+@fs entity_fs
+in vec2 uv;
+in vec4 color;
+
+out vec4 frag_color;
+
+void main() {
+    float r2 = dot(uv, uv);
+    if (r2 > 1.0) {
+        discard;
+    }
+    frag_color = vec4(color.rgb * (1.0 - 0.4 * r2), 1.0);
+}
+@end
+
+@program entity entity_vs entity_fs
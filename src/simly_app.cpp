@@ -1,72 +1,232 @@
 //------------------------------------------------------------------------------
-//  imgui-wgpu.c
+//  simly_app.cpp
 //
-//  Test ImGui rendering, no input handling!
+//  ImGui dashboard with GPU plots and offscreen simulation views, rendered
+//  with sokol_gfx on WebGPU (emscripten in the browser, Dawn on desktop) or
+//  on the dummy backend. Mouse and keyboard input go to ImGui and the
+//  views; see usage() for the command line.
 //------------------------------------------------------------------------------
 #include "wgpu_entry.h"
 #define SOKOL_IMPL
+#if !defined(SOKOL_DUMMY_BACKEND)
 #define SOKOL_WGPU
+#endif
 #include "imgui.h"
 #include "sokol_gfx.h"
 #include "sokol_log.h"
 #include "sokol_time.h"
 
-#if !defined(__EMSCRIPTEN__)
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if !defined(__EMSCRIPTEN__) && !defined(SOKOL_DUMMY_BACKEND)
 #include "GLFW/glfw3.h"
 #endif
 
+#include "arena.hpp"
 #include "dsl.hpp"
+#include "entities.hpp"
+#include "font_cache.hpp"
+#include "frame_ring.hpp"
+#include "pipeline_cache.hpp"
+#include "plot.hpp"
+#include "profiler.hpp"
+#include "render_targets.hpp"
+#include "resolution.hpp"
+#include "shaders.glsl.h"
+#include "viewport.hpp"
 
-static const size_t MaxVertices = 64 * 1024;
-static const size_t MaxIndices  = MaxVertices * 3;
-static const int Width          = 1024;
-static const int Height         = 768;
+// initial sizes of the per-frame upload rings, they grow on demand
+static const size_t InitialVertexRing = 4 * 1024 * 1024;
+static const size_t InitialIndexRing  = 1024 * 1024;
+static const int Width           = 1024;
+static const int Height          = 768;
+// presentation, FIFO with MaxFps = 0 runs at the display rate; lower caps
+// save power on always-on displays
+static const wgpu_present_mode_t PresentMode = WGPU_PRESENTMODE_FIFO;
+static const int MaxFps                      = 0;
+// the 3D views render at a scale of the UI resolution that keeps frames
+// within the paced frame interval (the MaxFps cap or the display interval),
+// TargetFrameTime (ms) without vsync and cap; the UI itself always renders
+// at device pixels
+static const double TargetFrameTime   = 1000.0 / 60.0;
+static const float MinResolutionScale = 0.5f;
+// frames checked for WebGPU validation errors; the default validates every
+// frame in debug builds and only after switching it on in release builds
+static const wgpu_validation_t Validation = WGPU_VALIDATION_DEFAULT;
+// without input for IdleTimeout seconds the UI only updates every
+// IdleFrameInterval seconds
+static const double IdleTimeout       = 2.0;
+static const double IdleFrameInterval = 0.25;
+// samples of the demo plot
+static const int PlotSamples = 1000000;
+// size of the demo entity population
+static const int NumEntities = 256 * 1024;
+// MSAA samples of the 3D views
+static const int ViewSampleCount = 4;
+// baked ImGui font atlas, written on first start
+static const char *FontCachePath = "imgui_font_atlas.bin";
+// capture runs advance with a fixed timestep so their images are reproducible
+static const double CaptureDeltaTime = 1.0 / 60.0;
+static const int CaptureWarmupFrames = 30;
+
+// one entry of the flattened per-frame ImGui command stream; vtx_base is
+// the first vertex of the binding segment the rebased indices refer to,
+// neighbouring commands with identical state are merged into one entry
+typedef struct {
+    const ImDrawList *list;
+    const ImDrawCmd *cmd;
+    ImDrawCallback user_callback;
+    ImVec4 clip_rect;
+    ImTextureID tex_id;
+    int vtx_base;
+    int base_element;
+    int num_elements;
+} imgui_cmd_t;
+
+// per-frame counters of the ImGui command stream optimizer
+typedef struct {
+    int num_cmds;
+    int num_draws;
+    int num_scissor_rects;
+    int num_bindings;
+} imgui_stats_t;
 
 static struct {
     sg_pass_action pass_action;
     sg_pipeline pip;
+    sg_pipeline font_pip;
+    sg_image font_img;
     sg_bindings bind;
+    simly::PlotRenderer plots;
+    std::vector<float> plot_x;
+    std::vector<float> plot_y;
+    simly::Viewport top_view;
+    simly::ResolutionScaler resolution;
+    simly::Viewport close_view;
+    std::vector<float> entity_x;
+    std::vector<float> entity_y;
+    std::vector<float> entity_z;
+    std::vector<float> entity_scale;
+    std::vector<uint32_t> entity_color;
+    simly::FrameRing vtx_ring;
+    simly::FrameRing idx_ring;
+    ImVector<imgui_cmd_t> cmds;
+    imgui_stats_t imgui_stats;
+    size_t imgui_vtx_offset  = 0;
+    size_t imgui_idx_offset  = 0;
+    uint64_t ui_hash         = 0;
     uint64_t last_time       = 0;
+    uint64_t last_input_time = 0;
+    uint64_t start_time      = 0;
+    double last_frame_ms     = 0.0;
+    double anim_time         = 0.0;
+    float ui_scale           = 1.0f;
     bool show_test_window    = true;
     bool show_another_window = false;
+    bool show_plot_window    = true;
+    bool show_entities       = true;
+    bool show_profiler       = false;
+    bool cull_entities       = true;
+    bool allow_idle          = true;
 } state;
 
-typedef struct {
-    ImVec2 disp_size;
-} vs_params_t;
-
+static bool imgui_changed(ImDrawData *);
+static void upload_imgui(ImDrawData *);
 static void draw_imgui(ImDrawData *);
+static void handle_input(void);
+static void view_window(const char *, const ImVec2 &, simly::Viewport &,
+                        const simly::EntityColumns &);
 
-static void init(void) {
-    // setup sokol-gfx, sokol-time and sokol-imgui
-    sg_desc desc     = {};
-    desc.environment = wgpu_environment();
-    desc.logger.func = slog_func;
-    sg_setup(&desc);
-    stm_setup();
+// UI layout constants are in unscaled pixels
+static ImVec2 scaled(float x, float y) {
+    return ImVec2(x * state.ui_scale, y * state.ui_scale);
+}
 
-    // input forwarding
-    wgpu_mouse_pos(
-        [](float x, float y) { ImGui::GetIO().MousePos = ImVec2(x, y); });
-    wgpu_mouse_btn_down([](int btn) { ImGui::GetIO().MouseDown[btn] = true; });
-    wgpu_mouse_btn_up([](int btn) { ImGui::GetIO().MouseDown[btn] = false; });
-    wgpu_mouse_wheel([](float v) { ImGui::GetIO().MouseWheel = v; });
-    wgpu_char([](uint32_t c) { ImGui::GetIO().AddInputCharacter(c); });
-    wgpu_key_down([](int key) {
-        if (key < 512)
-            ImGui::GetIO().KeysDown[key] = true;
-    });
-    wgpu_key_up([](int key) {
-        if (key < 512)
-            ImGui::GetIO().KeysDown[key] = false;
-    });
+// ImGui works in framebuffer pixels, on HiDPI screens the font is baked
+// and the style scaled for the device pixel ratio so text stays sharp; the
+// atlas has to be baked again afterwards
+static void set_ui_scale(float scale) {
+    state.ui_scale = scale;
+    ImGuiStyle style;
+    ImGui::StyleColorsDark(&style);
+    style.ScaleAllSizes(scale);
+    ImGui::GetStyle() = style;
+
+    ImFontAtlas *fonts = ImGui::GetIO().Fonts;
+    fonts->Clear();
+    ImFontConfig font_cfg = {};
+    font_cfg.SizePixels   = 13.0f * scale;
+    fonts->AddFontDefault(&font_cfg);
+}
+
+// CPU-only startup jobs, they run in parallel with each other and with the
+// adapter and device requests
+static void bake_font_atlas(void) {
+    SIMLY_PROFILE_SCOPE("font atlas");
+    // restored from the baked cache if possible
+    ImFontAtlas *fonts = ImGui::GetIO().Fonts;
+    if (!simly::load_font_atlas(fonts, FontCachePath)) {
+        fonts->Build();
+        simly::save_font_atlas(fonts, FontCachePath);
+    }
+}
+
+static void make_plot_signal(void) {
+    SIMLY_PROFILE_SCOPE("plot signal");
+    state.plot_x.resize(PlotSamples);
+    state.plot_y.resize(PlotSamples);
+    for (int i = 0; i < PlotSamples; i++) {
+        const float t    = float(i) * 0.001f;
+        state.plot_x[i] = t;
+        state.plot_y[i] = sinf(t) + 0.25f * sinf(t * 37.0f);
+    }
+}
+
+// a demo population on a flat spiral
+static void make_entity_population(void) {
+    SIMLY_PROFILE_SCOPE("entity population");
+    state.entity_x.resize(NumEntities);
+    state.entity_y.resize(NumEntities);
+    state.entity_z.resize(NumEntities);
+    state.entity_scale.resize(NumEntities);
+    state.entity_color.resize(NumEntities);
+    for (int i = 0; i < NumEntities; i++) {
+        const float t         = float(i) / float(NumEntities);
+        const float angle     = t * 40.0f * 3.14159265f;
+        const float radius    = 1.0f + t * 60.0f;
+        const float jitter    = sinf(float(i) * 12.9898f) * 2.0f;
+        state.entity_x[i]     = cosf(angle) * (radius + jitter);
+        state.entity_y[i]     = sinf(float(i) * 78.233f) * 1.5f;
+        state.entity_z[i]     = sinf(angle) * (radius + jitter);
+        state.entity_scale[i] = 0.1f + 0.1f * (1.0f - t);
+        state.entity_color[i] =
+            IM_COL32(255, int(255 * (1.0f - t)), int(128 + 127 * t), 255);
+    }
+}
+
+static void (*const StartupJobs[])(void) = {
+    bake_font_atlas,
+    make_plot_signal,
+    make_entity_population,
+};
+
+// runs before the device exists, must not call into sokol-gfx
+static void preinit(void) {
+    stm_setup();
+    state.start_time = stm_now();
 
     // setup Dear Imgui
     ImGui::CreateContext();
-    ImGui::StyleColorsDark();
     ImGuiIO &io    = ImGui::GetIO();
     io.IniFilename = nullptr;
-    io.Fonts->AddFontDefault();
+    set_ui_scale(wgpu_dpi_scale());
     io.KeyMap[ImGuiKey_Tab]        = WGPU_KEY_TAB;
     io.KeyMap[ImGuiKey_LeftArrow]  = WGPU_KEY_LEFT;
     io.KeyMap[ImGuiKey_RightArrow] = WGPU_KEY_RIGHT;
@@ -84,73 +244,66 @@ static void init(void) {
     io.KeyMap[ImGuiKey_X]          = 'X';
     io.KeyMap[ImGuiKey_Y]          = 'Y';
     io.KeyMap[ImGuiKey_Z]          = 'Z';
+    // draw commands may carry a base vertex, so 16-bit index lists are not
+    // capped at 64k vertices
+    io.BackendFlags |= ImGuiBackendFlags_RendererHasVtxOffset;
 
-    // dynamic vertex- and index-buffers for imgui-generated geometry
-    sg_buffer_desc vbuf_desc     = {};
-    vbuf_desc.usage              = SG_USAGE_STREAM;
-    vbuf_desc.size               = MaxVertices * sizeof(ImDrawVert);
-    state.bind.vertex_buffers[0] = sg_make_buffer(&vbuf_desc);
-
-    sg_buffer_desc ibuf_desc = {};
-    ibuf_desc.type           = SG_BUFFERTYPE_INDEXBUFFER;
-    ibuf_desc.usage          = SG_USAGE_STREAM;
-    ibuf_desc.size           = MaxIndices * sizeof(ImDrawIdx);
-    state.bind.index_buffer  = sg_make_buffer(&ibuf_desc);
+    // one job per worker, a pool of one runs them back to back
+    const size_t num_jobs   = sizeof(StartupJobs) / sizeof(StartupJobs[0]);
+    simly::ThreadPool &pool = simly::default_pool();
+    pool.parallel_for(num_jobs, 1, [](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; i++)
+            StartupJobs[i]();
+    });
+}
 
-    // font texture and sampler for imgui's default font
+// font atlas for imgui's default font; the atlas only has coverage, so it
+// is uploaded as R8 and the CPU copy is dropped afterwards
+static void make_font_image(void) {
+    ImFontAtlas *fonts = ImGui::GetIO().Fonts;
     unsigned char *font_pixels;
     int font_width, font_height;
-    io.Fonts->GetTexDataAsRGBA32(&font_pixels, &font_width, &font_height);
+    fonts->GetTexDataAsAlpha8(&font_pixels, &font_width, &font_height);
 
     sg_image_desc img_desc = {};
     img_desc.width         = font_width;
     img_desc.height        = font_height;
-    img_desc.pixel_format  = SG_PIXELFORMAT_RGBA8;
+    img_desc.pixel_format  = SG_PIXELFORMAT_R8;
     img_desc.data.subimage[0][0] =
-        sg_range{font_pixels, size_t(font_width * font_height * 4)};
-    state.bind.fs.images[0] = sg_make_image(&img_desc);
+        sg_range{font_pixels, size_t(font_width * font_height)};
+    state.font_img = sg_make_image(&img_desc);
+    fonts->TexID   = (ImTextureID)(uintptr_t)state.font_img.id;
+    fonts->ClearTexData();
+}
 
+// the device is ready, upload what preinit() prepared
+static void init(void) {
+    sg_desc desc     = {};
+    desc.environment = wgpu_environment();
+    desc.logger.func = slog_func;
+    sg_setup(&desc);
+
+    // per-frame upload rings for all dynamic geometry
+    state.vtx_ring.init(SG_BUFFERTYPE_VERTEXBUFFER, InitialVertexRing);
+    state.idx_ring.init(SG_BUFFERTYPE_INDEXBUFFER, InitialIndexRing);
+
+    make_font_image();
+
+    // linear filtering also upscales the views when they render at a
+    // reduced resolution
     sg_sampler_desc smp_desc  = {};
+    smp_desc.min_filter       = SG_FILTER_LINEAR;
+    smp_desc.mag_filter       = SG_FILTER_LINEAR;
     smp_desc.wrap_u           = SG_WRAP_CLAMP_TO_EDGE;
     smp_desc.wrap_v           = SG_WRAP_CLAMP_TO_EDGE;
     state.bind.fs.samplers[0] = sg_make_sampler(&smp_desc);
 
-    // shader object for imgui rendering
-    sg_shader_desc shd_desc            = {};
-    shd_desc.vs.uniform_blocks[0].size = sizeof(vs_params_t);
-    shd_desc.vs.source =
-        "struct vs_params {\n"
-        "  disp_size: vec2f,\n"
-        "}\n"
-        "@group(0) @binding(0) var<uniform> in: vs_params;\n"
-        "struct vs_out {\n"
-        "  @builtin(position) pos: vec4f,\n"
-        "  @location(0) uv: vec2f,\n"
-        "  @location(1) color: vec4f,\n"
-        "}\n"
-        "@vertex fn main(@location(0) pos: vec2f, @location(1) uv: vec2f, "
-        "@location(2) color: vec4f) -> vs_out {\n"
-        "  var out: vs_out;\n"
-        "  out.pos = vec4f(((pos/in.disp_size) - 0.5) * vec2f(2,-2), 0.5, "
-        "1.0);\n"
-        "  out.uv = uv;\n"
-        "  out.color = color;\n"
-        "  return out;\n"
-        "}\n";
-    shd_desc.fs.images[0].used                      = true;
-    shd_desc.fs.samplers[0].used                    = true;
-    shd_desc.fs.image_sampler_pairs[0].used         = true;
-    shd_desc.fs.image_sampler_pairs[0].image_slot   = 0;
-    shd_desc.fs.image_sampler_pairs[0].sampler_slot = 0;
-    shd_desc.fs.source = "@group(1) @binding(48) var tex: texture_2d<f32>;\n"
-                         "@group(1) @binding(64) var smp: sampler;\n"
-                         "@fragment fn main(@location(0) uv: vec2f, "
-                         "@location(1) color: vec4f) -> @location(0) vec4f {\n"
-                         "  return textureSample(tex, smp, uv) * color;\n"
-                         "}\n";
-    sg_shader shd      = sg_make_shader(&shd_desc);
-
-    // pipeline object for imgui rendering
+    // pipeline objects for imgui rendering, one for the single-channel font
+    // atlas and one for RGBA user textures; created right away since the UI
+    // has to show up in the first frame
+    simly::PipelineCache &cache = simly::default_pipeline_cache();
+    const sg_backend backend    = simly::shader_backend();
+
     sg_pipeline_desc pip_desc               = {};
     pip_desc.layout.buffers[0].stride       = sizeof(ImDrawVert);
     auto &attrs                             = pip_desc.layout.attrs;
@@ -160,24 +313,110 @@ static void init(void) {
     attrs[1].format                         = SG_VERTEXFORMAT_FLOAT2;
     attrs[2].offset                         = offsetof(ImDrawVert, col);
     attrs[2].format                         = SG_VERTEXFORMAT_UBYTE4N;
-    pip_desc.shader                         = shd;
-    pip_desc.index_type                     = SG_INDEXTYPE_UINT16;
+    pip_desc.index_type = (sizeof(ImDrawIdx) == 2) ? SG_INDEXTYPE_UINT16
+                                                   : SG_INDEXTYPE_UINT32;
     pip_desc.colors[0].blend.enabled        = true;
     pip_desc.colors[0].blend.src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA;
     pip_desc.colors[0].blend.dst_factor_rgb =
         SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA;
     pip_desc.colors[0].write_mask = SG_COLORMASK_RGB;
-    state.pip                     = sg_make_pipeline(&pip_desc);
+
+    pip_desc.shader = cache.get_shader(imgui_shader_desc(backend));
+    pip_desc.label  = "imgui";
+    state.pip       = cache.get(pip_desc, false);
+    pip_desc.shader = cache.get_shader(imgui_font_shader_desc(backend));
+    pip_desc.label  = "imgui-font";
+    state.font_pip  = cache.get(pip_desc, false);
+
+    // GPU plots of the demo signal
+    state.plots.init(state.vtx_ring);
+
+    // a top-down overview and an orbiting closeup of the demo population
+    state.top_view.init("top-down", state.vtx_ring, ViewSampleCount);
+    state.top_view.camera.latitude = 85.0f;
+    state.top_view.camera.distance = 150.0f;
+    state.top_view.camera.max_dist = 300.0f;
+    state.top_view.camera.farz     = 500.0f;
+    state.close_view.init("closeup", state.vtx_ring, ViewSampleCount);
+    state.close_view.camera.latitude = 20.0f;
+    state.close_view.camera.distance = 15.0f;
+    state.close_view.camera.max_dist = 100.0f;
+    state.close_view.camera.farz     = 200.0f;
+    state.resolution.target_ms       = TargetFrameTime;
+    state.resolution.min_scale       = MinResolutionScale;
+    // capture runs have to render the same images every time
+    state.resolution.enabled = !wgpu_capturing();
 
     // initial clear color
     state.pass_action.colors[0].load_action = SG_LOADACTION_CLEAR;
     state.pass_action.colors[0].clear_value = {0.0f, 0.5f, 0.7f, 1.0f};
+
+    // start out of idle mode
+    state.last_input_time = stm_now();
+}
+
+// CPU time since the last lap, recorded as a stage of a capture run and
+// as a span of the profiler timeline
+static void lap_stage(const char *name, uint64_t *lap) {
+    const uint64_t start = *lap;
+    wgpu_capture_stage(name, stm_ms(stm_laptime(lap)));
+    simly::default_profiler().record(name, start, *lap);
 }
 
 static void frame(void) {
+    simly::default_profiler().frame();
+    if (state.start_time != 0) {
+        // preinit to the first frame, shows up in the exported trace
+        simly::default_profiler().record("startup", state.start_time,
+                                         stm_now());
+        state.start_time = 0;
+    }
+    SIMLY_PROFILE_SCOPE("frame");
+    handle_input();
+
+    // idle mode: skip the whole frame (no UI update, no present) unless
+    // there was recent input or the idle refresh interval has passed
+    const bool idle = state.allow_idle &&
+                      (stm_sec(stm_since(state.last_input_time)) > IdleTimeout);
+    if (idle && (stm_sec(stm_since(state.last_time)) < IdleFrameInterval)) {
+        return;
+    }
+
     const int cur_width         = wgpu_width();
     const int cur_height        = wgpu_height();
-    const double cur_delta_time = stm_sec(stm_laptime(&state.last_time));
+    const double lap_delta_time = stm_sec(stm_laptime(&state.last_time));
+    const double cur_delta_time =
+        wgpu_capturing() ? CaptureDeltaTime : lap_delta_time;
+    // the demo animations pause in idle mode, so an untouched UI settles
+    // and its frames are skipped below
+    const double anim_delta_time = idle ? 0.0 : cur_delta_time;
+    state.anim_time += anim_delta_time;
+
+    // start of the first capture stage
+    const uint64_t frame_start = stm_now();
+    uint64_t lap               = frame_start;
+
+    // scene resolution for this frame from the cost of the previous ones
+    state.resolution.update(state.last_frame_ms, wgpu_frame_interval(),
+                            wgpu_frame_budget());
+
+    // create deferred pipelines, a few per frame
+    simly::default_pipeline_cache().update();
+    // drop view targets that weren't used for a while
+    simly::default_render_targets().update();
+
+    // the device pixel ratio changes when the window moves to a monitor
+    // with another scale (or the page is zoomed), rebuild the UI for it
+    if (wgpu_dpi_scale() != state.ui_scale) {
+        set_ui_scale(wgpu_dpi_scale());
+        bake_font_atlas();
+        sg_destroy_image(state.font_img);
+        make_font_image();
+    }
+
+    // all dynamic geometry of the frame goes through the upload rings
+    state.vtx_ring.begin_frame();
+    state.idx_ring.begin_frame();
 
     // this is standard ImGui demo code
     ImGuiIO &io    = ImGui::GetIO();
@@ -197,99 +436,509 @@ static void frame(void) {
         state.show_test_window ^= 1;
     if (ImGui::Button("Another Window"))
         state.show_another_window ^= 1;
+    if (ImGui::Button("Plot Window"))
+        state.show_plot_window ^= 1;
+    ImGui::SameLine();
+    if (ImGui::Button("Profiler"))
+        state.show_profiler ^= 1;
+    ImGui::Checkbox("entity views", &state.show_entities);
+    ImGui::SameLine();
+    ImGui::Checkbox("frustum culling", &state.cull_entities);
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)",
                 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    if (!wgpu_capturing()) {
+        ImGui::Text("Frame interval %.2f ms (budget %.2f), jitter %.2f ms",
+                    wgpu_frame_interval(), wgpu_frame_budget(),
+                    wgpu_frame_jitter());
+    }
+    const wgpu_errors_t errors = wgpu_errors();
+    bool validation            = wgpu_validation();
+    if (ImGui::Checkbox("validation", &validation))
+        wgpu_set_validation(validation);
+    ImGui::SameLine();
+    ImGui::Text("%d validation, %d OOM, %d other errors",
+                errors.num_validation, errors.num_out_of_memory,
+                errors.num_internal);
+    ImGui::Checkbox("dynamic resolution", &state.resolution.enabled);
+    ImGui::SameLine();
+    ImGui::Text("views at %d%%",
+                int(state.resolution.get_scale() * 100.0f + 0.5f));
+    const simly::RenderTargetPool &targets = simly::default_render_targets();
+    ImGui::Text("view targets: %d images, %.1f MB",
+                (int)targets.get_num_images(),
+                double(targets.get_num_bytes()) / (1024.0 * 1024.0));
+    ImGui::Text("UI draws: %d cmds -> %d draws, %d scissor, %d bindings",
+                state.imgui_stats.num_cmds, state.imgui_stats.num_draws,
+                state.imgui_stats.num_scissor_rects,
+                state.imgui_stats.num_bindings);
 
     // 2. Show another simple window, this time using an explicit Begin/End pair
     if (state.show_another_window) {
-        ImGui::SetNextWindowSize(ImVec2(200, 100), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(scaled(200, 100), ImGuiCond_FirstUseEver);
         ImGui::Begin("Another Window", &state.show_another_window);
         ImGui::Text("Hello");
         ImGui::End();
     }
 
+    // GPU plot of a large signal, the visible range follows the slider
+    if (state.show_plot_window) {
+        ImGui::SetNextWindowSize(scaled(400, 240), ImGuiCond_FirstUseEver);
+        ImGui::Begin("Plot", &state.show_plot_window);
+        static float plot_span = 100.0f;
+        ImGui::SliderFloat("span", &plot_span, 1.0f, 900.0f);
+        ImGui::Text("%d plot points", state.plots.get_uploaded_points());
+        const ImVec2 pos  = ImGui::GetCursorScreenPos();
+        const ImVec2 size = ImGui::GetContentRegionAvail();
+        if ((size.x > 0.0f) && (size.y > 0.0f)) {
+            simly::PlotSeries series;
+            series.x     = state.plot_x.data();
+            series.y     = state.plot_y.data();
+            series.count = state.plot_x.size();
+            series.color = IM_COL32(255, 200, 64, 255);
+
+            // scroll through the signal over time
+            const float x_end = PlotSamples * 0.001f - plot_span;
+            const float x_min = fmodf(float(state.anim_time), x_end);
+            state.plots.plot(ImGui::GetWindowDrawList(), pos, size, &series, 1,
+                             x_min, x_min + plot_span, -1.5f, 1.5f);
+            ImGui::Dummy(size);
+        }
+        ImGui::End();
+    }
+
+    // simulation views, each one only culls, packs and renders what its
+    // camera can see
+    if (state.show_entities) {
+        simly::EntityColumns columns;
+        columns.x     = state.entity_x.data();
+        columns.y     = state.entity_y.data();
+        columns.z     = state.entity_z.data();
+        columns.scale = state.entity_scale.data();
+        columns.color = state.entity_color.data();
+        columns.count = NumEntities;
+        state.close_view.camera.orbit(-float(anim_delta_time) * 5.0f, 0.0f);
+        state.top_view.cull   = state.cull_entities;
+        state.close_view.cull = state.cull_entities;
+        view_window("Top-down", scaled(20, 320), state.top_view, columns);
+        view_window("Closeup", scaled(360, 320), state.close_view, columns);
+    }
+
+    if (state.show_profiler) {
+        ImGui::SetNextWindowPos(scaled(20, 620), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(scaled(600, 200), ImGuiCond_FirstUseEver);
+        simly::default_profiler().draw_panel(&state.show_profiler);
+    }
+
     // 3. Show the ImGui test window. Most of the sample code is in
     // ImGui::ShowDemoWindow()
     if (state.show_test_window) {
-        ImGui::SetNextWindowPos(ImVec2(460, 20), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowPos(scaled(460, 20), ImGuiCond_FirstUseEver);
         ImGui::ShowDemoWindow();
     }
 
+    // if the draw stream is identical to the last presented one and
+    // neither the plots nor the view images changed, don't even acquire a
+    // swapchain image, the canvas keeps its content
+    ImGui::Render();
+    ImDrawData *draw_data = ImGui::GetDrawData();
+    lap_stage("ui", &lap);
+    const bool views_changed =
+        state.top_view.needs_render() || state.close_view.needs_render();
+    if (!imgui_changed(draw_data) && !state.plots.changed() &&
+        !views_changed) {
+        state.plots.discard();
+        simly::FrameArena::reset_all();
+        sg_commit();
+        return;
+    }
+
+    // one upload per ring for the whole frame
+    state.plots.upload();
+    upload_imgui(draw_data);
+    state.vtx_ring.commit();
+    state.idx_ring.commit();
+    simly::FrameArena::reset_all();
+    lap_stage("upload", &lap);
+
+    // offscreen passes of the views, composited by the UI pass
+    state.top_view.render();
+    state.close_view.render();
+    lap_stage("offscreen", &lap);
+
     // the sokol_gfx draw pass
     sg_pass pass   = {};
     pass.action    = state.pass_action;
     pass.swapchain = wgpu_swapchain();
     sg_begin_pass(&pass);
-    ImGui::Render();
-    draw_imgui(ImGui::GetDrawData());
+    draw_imgui(draw_data);
     sg_end_pass();
+    lap_stage("draw_imgui", &lap);
     sg_commit();
+    lap_stage("commit", &lap);
+    state.last_frame_ms = stm_ms(stm_since(frame_start));
 }
 
-static void shutdown(void) { sg_shutdown(); }
+static void shutdown(void) {
+    state.close_view.shutdown();
+    state.top_view.shutdown();
+    simly::default_render_targets().shutdown();
+    simly::default_pipeline_cache().shutdown();
+    state.idx_ring.shutdown();
+    state.vtx_ring.shutdown();
+    sg_shutdown();
+}
 
-// render ImGui draw lists through sokol-gfx
-void draw_imgui(ImDrawData *draw_data) {
-    assert(draw_data);
-    if (draw_data->CmdListsCount == 0) {
-        return;
+// drain the input events queued since the last frame into ImGui, any event
+// also wakes the UI from idle mode; mouse input goes through ImGui's own
+// event queue so a click within one frame isn't lost
+static void handle_input(void) {
+    SIMLY_PROFILE_SCOPE("input");
+    ImGuiIO &io = ImGui::GetIO();
+    wgpu_event_t ev;
+    while (wgpu_next_event(&ev)) {
+        state.last_input_time = stm_now();
+        switch (ev.type) {
+        case WGPU_EVENTTYPE_KEY_DOWN:
+        case WGPU_EVENTTYPE_KEY_UP:
+            // key codes come from the platform layer, guard the array
+            if (((int)ev.key >= 0) &&
+                ((int)ev.key < IM_ARRAYSIZE(io.KeysDown)))
+                io.KeysDown[ev.key] = (ev.type == WGPU_EVENTTYPE_KEY_DOWN);
+            break;
+        case WGPU_EVENTTYPE_CHAR:
+            io.AddInputCharacter(ev.char_code);
+            break;
+        case WGPU_EVENTTYPE_MOUSE_DOWN:
+        case WGPU_EVENTTYPE_MOUSE_UP:
+            io.AddMouseButtonEvent(ev.mouse_button,
+                                   ev.type == WGPU_EVENTTYPE_MOUSE_DOWN);
+            break;
+        case WGPU_EVENTTYPE_MOUSE_MOVE:
+            io.AddMousePosEvent(ev.mouse_x, ev.mouse_y);
+            break;
+        case WGPU_EVENTTYPE_MOUSE_WHEEL:
+            io.AddMouseWheelEvent(0.0f, ev.wheel);
+            break;
+        default:
+            break;
+        }
     }
+}
 
-    // render the command list
-    vs_params_t vs_params;
-    vs_params.disp_size.x = ImGui::GetIO().DisplaySize.x;
-    vs_params.disp_size.y = ImGui::GetIO().DisplaySize.y;
-    sg_apply_pipeline(state.pip);
-    sg_apply_uniforms(SG_SHADERSTAGE_VS, 0, SG_RANGE(vs_params));
+// window showing one simulation view, the target follows the window size;
+// drag to orbit, mouse wheel to zoom
+static void view_window(const char *title, const ImVec2 &pos,
+                        simly::Viewport &view,
+                        const simly::EntityColumns &columns) {
+    ImGui::SetNextWindowPos(pos, ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(scaled(320, 280), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin(title, nullptr, ImGuiWindowFlags_NoScrollbar)) {
+        ImGui::Text("%d of %d entities visible", (int)view.get_num_visible(),
+                    (int)columns.count);
+        const ImVec2 origin = ImGui::GetCursorScreenPos();
+        const ImVec2 size   = ImGui::GetContentRegionAvail();
+        if ((size.x >= 1.0f) && (size.y >= 1.0f)) {
+            // rendered at the dynamic resolution, upscaled by the UI pass
+            const float scale = state.resolution.get_scale();
+            view.resize(std::max(1, int(size.x * scale)),
+                        std::max(1, int(size.y * scale)));
+            view.prepare(columns);
+            ImGui::GetWindowDrawList()->AddImage(
+                view.get_texture(), origin,
+                ImVec2(origin.x + size.x, origin.y + size.y), ImVec2(0, 0),
+                view.get_uv_max());
+            ImGui::InvisibleButton("view", size);
+            const ImGuiIO &io = ImGui::GetIO();
+            if (ImGui::IsItemActive()) {
+                view.camera.orbit(io.MouseDelta.x * 0.25f,
+                                  io.MouseDelta.y * 0.25f);
+            }
+            if (ImGui::IsItemHovered() && (io.MouseWheel != 0.0f)) {
+                view.camera.zoom(-io.MouseWheel * view.camera.distance * 0.1f);
+            }
+        }
+    }
+    ImGui::End();
+}
+
+// gather all ImGui draw lists into one contiguous vertex and index range
+// of the upload rings, rebasing indices so that most commands share a
+// single binding
+static void gather_imgui(ImDrawData *draw_data, ImDrawVert *vtx_dst,
+                         ImDrawIdx *idx_dst) {
+    const int idx_limit = (sizeof(ImDrawIdx) == 2) ? 0xFFFF : 0x7FFFFFFF;
+    state.cmds.resize(0);
+    int seg_vtx_base  = 0;
+    int list_vtx_base = 0;
+    int list_idx_base = 0;
     for (int cl_index = 0; cl_index < draw_data->CmdListsCount; cl_index++) {
         const ImDrawList *cl = draw_data->CmdLists[cl_index];
-
-        // append vertices and indices to buffers, record start offsets in
-        // bindings struct
-        const uint32_t vtx_size  = cl->VtxBuffer.size() * sizeof(ImDrawVert);
-        const uint32_t idx_size  = cl->IdxBuffer.size() * sizeof(ImDrawIdx);
-        const uint32_t vb_offset = sg_append_buffer(
-            state.bind.vertex_buffers[0], {&cl->VtxBuffer.front(), vtx_size});
-        const uint32_t ib_offset = sg_append_buffer(
-            state.bind.index_buffer, {&cl->IdxBuffer.front(), idx_size});
-        /* don't render anything if the buffer is in overflow state (this is
-           also checked internally in sokol_gfx, draw calls that attempt to draw
-           from overflowed buffers will be silently dropped)
-        */
-        if (sg_query_buffer_overflow(state.bind.vertex_buffers[0]) ||
-            sg_query_buffer_overflow(state.bind.index_buffer)) {
-            continue;
+        const int vtx_count  = cl->VtxBuffer.Size;
+        const int idx_count  = cl->IdxBuffer.Size;
+        memcpy(vtx_dst + list_vtx_base, cl->VtxBuffer.Data,
+               vtx_count * sizeof(ImDrawVert));
+        for (const ImDrawCmd &pcmd : cl->CmdBuffer) {
+            const int cmd_vtx_base = list_vtx_base + (int)pcmd.VtxOffset;
+            const int cmd_vtx_max  = vtx_count - (int)pcmd.VtxOffset;
+            // start a new binding segment when the rebased indices of this
+            // command could overflow ImDrawIdx
+            if ((cmd_vtx_base - seg_vtx_base) + cmd_vtx_max - 1 > idx_limit) {
+                seg_vtx_base = cmd_vtx_base;
+            }
+            const int rebase     = cmd_vtx_base - seg_vtx_base;
+            const ImDrawIdx *src = cl->IdxBuffer.Data + pcmd.IdxOffset;
+            ImDrawIdx *dst       = idx_dst + list_idx_base + pcmd.IdxOffset;
+            if (rebase == 0) {
+                memcpy(dst, src, pcmd.ElemCount * sizeof(ImDrawIdx));
+            } else {
+                for (unsigned int i = 0; i < pcmd.ElemCount; i++) {
+                    dst[i] = (ImDrawIdx)(src[i] + rebase);
+                }
+            }
+            state.imgui_stats.num_cmds++;
+            const int base_element = list_idx_base + (int)pcmd.IdxOffset;
+            // extend the previous draw if it has the same clip rect, texture
+            // and binding segment and its indices end where ours start
+            if (!pcmd.UserCallback && (state.cmds.Size > 0)) {
+                imgui_cmd_t &prev = state.cmds.back();
+                if (!prev.user_callback &&
+                    (prev.vtx_base == seg_vtx_base) &&
+                    (prev.tex_id == pcmd.TextureId) &&
+                    (prev.base_element + prev.num_elements == base_element) &&
+                    (memcmp(&prev.clip_rect, &pcmd.ClipRect,
+                            sizeof(ImVec4)) == 0)) {
+                    prev.num_elements += (int)pcmd.ElemCount;
+                    continue;
+                }
+            }
+            imgui_cmd_t cmd;
+            cmd.list          = cl;
+            cmd.cmd           = &pcmd;
+            cmd.user_callback = pcmd.UserCallback;
+            cmd.clip_rect     = pcmd.ClipRect;
+            cmd.tex_id        = pcmd.TextureId;
+            cmd.vtx_base      = seg_vtx_base;
+            cmd.base_element  = base_element;
+            cmd.num_elements  = (int)pcmd.ElemCount;
+            state.cmds.push_back(cmd);
         }
+        list_vtx_base += vtx_count;
+        list_idx_base += idx_count;
+    }
+}
+
+static uint64_t hash_bytes(uint64_t h, const void *ptr, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)ptr;
+    const uint64_t mul   = 0x9E3779B97F4A7C15ull;
+    size_t i             = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w;
+        memcpy(&w, bytes + i, 8);
+        h = (h ^ w) * mul;
+        h ^= h >> 29;
+    }
+    for (; i < size; i++) {
+        h = (h ^ bytes[i]) * mul;
+    }
+    return h;
+}
 
-        state.bind.vertex_buffer_offsets[0] = vb_offset;
-        state.bind.index_buffer_offset      = ib_offset;
-        sg_apply_bindings(&state.bind);
+// hash of everything that affects the rendered UI; the clear color is
+// included since it is part of the same image. Draw callbacks only count
+// by their function, what they draw is tracked by their renderers.
+static uint64_t hash_imgui(ImDrawData *draw_data) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    h          = hash_bytes(h, &draw_data->DisplaySize, sizeof(ImVec2));
+    h          = hash_bytes(h, &state.pass_action.colors[0].clear_value,
+                            sizeof(sg_color));
+    for (int cl_index = 0; cl_index < draw_data->CmdListsCount; cl_index++) {
+        const ImDrawList *cl = draw_data->CmdLists[cl_index];
 
-        int base_element = 0;
+        h = hash_bytes(h, cl->VtxBuffer.Data, cl->VtxBuffer.size_in_bytes());
+        h = hash_bytes(h, cl->IdxBuffer.Data, cl->IdxBuffer.size_in_bytes());
         for (const ImDrawCmd &pcmd : cl->CmdBuffer) {
-            if (pcmd.UserCallback) {
-                pcmd.UserCallback(cl, &pcmd);
-            } else {
-                const int scissor_x = (int)(pcmd.ClipRect.x);
-                const int scissor_y = (int)(pcmd.ClipRect.y);
-                const int scissor_w = (int)(pcmd.ClipRect.z - pcmd.ClipRect.x);
-                const int scissor_h = (int)(pcmd.ClipRect.w - pcmd.ClipRect.y);
+            h = hash_bytes(h, &pcmd.ClipRect, sizeof(ImVec4));
+            h = hash_bytes(h, &pcmd.TextureId, sizeof(ImTextureID));
+            h = hash_bytes(h, &pcmd.VtxOffset, sizeof(unsigned int));
+            h = hash_bytes(h, &pcmd.IdxOffset, sizeof(unsigned int));
+            h = hash_bytes(h, &pcmd.ElemCount, sizeof(unsigned int));
+            h = hash_bytes(h, &pcmd.UserCallback, sizeof(ImDrawCallback));
+        }
+    }
+    return h;
+}
+
+// returns false if the draw stream is unchanged since the last call and the
+// previously presented image is still valid
+static bool imgui_changed(ImDrawData *draw_data) {
+    assert(draw_data);
+    const uint64_t hash = hash_imgui(draw_data);
+    const bool changed  = (hash != state.ui_hash);
+    state.ui_hash       = hash;
+    return changed;
+}
+
+// gather the frame's ImGui geometry into the upload rings; must be called
+// between FrameRing::begin_frame() and commit()
+static void upload_imgui(ImDrawData *draw_data) {
+    assert(draw_data);
+    state.cmds.resize(0);
+    state.imgui_stats = {};
+    if ((draw_data->TotalVtxCount == 0) || (draw_data->TotalIdxCount == 0)) {
+        return;
+    }
+    ImDrawVert *vtx_dst;
+    ImDrawIdx *idx_dst;
+    state.imgui_vtx_offset =
+        state.vtx_ring.allocate_array(draw_data->TotalVtxCount, &vtx_dst);
+    state.imgui_idx_offset =
+        state.idx_ring.allocate_array(draw_data->TotalIdxCount, &idx_dst);
+    gather_imgui(draw_data, vtx_dst, idx_dst);
+}
+
+// render ImGui draw lists through sokol-gfx, upload_imgui() must have been
+// called for the same draw data and the rings committed before the pass
+// started
+void draw_imgui(ImDrawData *draw_data) {
+    assert(draw_data);
+    if (state.cmds.Size == 0) {
+        return;
+    }
+
+    // render the command list
+    imgui_params_t params = {};
+    params.disp_size[0]   = ImGui::GetIO().DisplaySize.x;
+    params.disp_size[1]   = ImGui::GetIO().DisplaySize.y;
+    // the ring buffers may have been recreated by commit()
+    state.bind.vertex_buffers[0]   = state.vtx_ring.get_buffer();
+    state.bind.index_buffer        = state.idx_ring.get_buffer();
+    state.bind.index_buffer_offset = int(state.imgui_idx_offset);
+
+    // only touch pipeline, bindings and scissor rect when they actually
+    // change, user callbacks (e.g. GPU plots) may apply their own state, so
+    // everything is re-applied after one
+    const ImTextureID font_tex = ImGui::GetIO().Fonts->TexID;
+    imgui_stats_t &stats       = state.imgui_stats;
+    bool reset_state           = true;
+    sg_pipeline bound_pip      = {};
+    int bound_vtx_base         = -1;
+    ImTextureID bound_tex      = 0;
+    ImVec4 bound_clip          = ImVec4(-1.0f, -1.0f, -1.0f, -1.0f);
+    for (const imgui_cmd_t &cmd : state.cmds) {
+        if (cmd.user_callback) {
+            if (cmd.user_callback != ImDrawCallback_ResetRenderState) {
+                cmd.user_callback(cmd.list, cmd.cmd);
+            }
+            reset_state = true;
+        } else {
+            const sg_pipeline pip =
+                (cmd.tex_id == font_tex) ? state.font_pip : state.pip;
+            if (reset_state || (pip.id != bound_pip.id)) {
+                sg_apply_pipeline(pip);
+                sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_imgui_params,
+                                  SG_RANGE(params));
+                bound_pip      = pip;
+                bound_vtx_base = -1;
+                bound_clip     = ImVec4(-1.0f, -1.0f, -1.0f, -1.0f);
+                reset_state    = false;
+            }
+            if ((cmd.vtx_base != bound_vtx_base) ||
+                (cmd.tex_id != bound_tex)) {
+                state.bind.vertex_buffer_offsets[0] =
+                    int(state.imgui_vtx_offset) +
+                    cmd.vtx_base * (int)sizeof(ImDrawVert);
+                state.bind.fs.images[0].id = (uint32_t)(uintptr_t)cmd.tex_id;
+                sg_apply_bindings(&state.bind);
+                bound_vtx_base = cmd.vtx_base;
+                bound_tex      = cmd.tex_id;
+                stats.num_bindings++;
+            }
+            if (memcmp(&cmd.clip_rect, &bound_clip, sizeof(ImVec4)) != 0) {
+                const int scissor_x = (int)(cmd.clip_rect.x);
+                const int scissor_y = (int)(cmd.clip_rect.y);
+                const int scissor_w = (int)(cmd.clip_rect.z - cmd.clip_rect.x);
+                const int scissor_h = (int)(cmd.clip_rect.w - cmd.clip_rect.y);
                 sg_apply_scissor_rect(scissor_x, scissor_y, scissor_w,
                                       scissor_h, true);
-                sg_draw(base_element, pcmd.ElemCount, 1);
+                bound_clip = cmd.clip_rect;
+                stats.num_scissor_rects++;
             }
-            base_element += pcmd.ElemCount;
+            sg_draw(cmd.base_element, cmd.num_elements, 1);
+            stats.num_draws++;
         }
     }
 }
 
-int main() {
-    wgpu_desc_t desc = {};
-    desc.init_cb     = init;
-    desc.frame_cb    = frame;
-    desc.shutdown_cb = shutdown;
-    desc.width       = Width;
-    desc.height      = Height;
+// a non-negative decimal frame count, nothing else
+static bool parse_count(const char *str, int *out) {
+    if (!str || !isdigit((unsigned char)str[0])) {
+        return false;
+    }
+    char *end        = nullptr;
+    const long count = strtol(str, &end, 10);
+    if ((*end != 0) || (count > INT_MAX)) {
+        return false;
+    }
+    *out = (int)count;
+    return true;
+}
+
+// quits after max_frames frames if given; --capture renders that many
+// measured frames offscreen (after --warmup frames) and writes per-stage
+// timings, with --hash also the image hashes, as JSON to the report path
+// or stdout
+static int usage(const char *exe) {
+    fprintf(stderr,
+            "usage: %s [max_frames]\n"
+            "       %s --capture frames [--warmup frames] [--hash] "
+            "[--report path]\n",
+            exe, exe);
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    wgpu_desc_t desc  = {};
+    desc.preinit_cb   = preinit;
+    desc.init_cb      = init;
+    desc.frame_cb     = frame;
+    desc.shutdown_cb  = shutdown;
+    desc.width        = Width;
+    desc.height       = Height;
+    desc.present_mode = PresentMode;
+    desc.max_fps      = MaxFps;
+    desc.validation   = Validation;
+    desc.high_dpi     = true;
+
+    desc.capture.warmup_frames = CaptureWarmupFrames;
+    for (int i = 1; i < argc; i++) {
+        const char *arg   = argv[i];
+        const char *value = ((i + 1) < argc) ? argv[i + 1] : nullptr;
+        if (0 == strcmp(arg, "--capture")) {
+            if (!parse_count(value, &desc.capture.num_frames) ||
+                (desc.capture.num_frames == 0)) {
+                return usage(argv[0]);
+            }
+            desc.capture.enabled = true;
+            i++;
+        } else if (0 == strcmp(arg, "--warmup")) {
+            if (!parse_count(value, &desc.capture.warmup_frames)) {
+                return usage(argv[0]);
+            }
+            i++;
+        } else if (0 == strcmp(arg, "--hash")) {
+            desc.capture.hash_images = true;
+        } else if (0 == strcmp(arg, "--report")) {
+            if (!value) {
+                return usage(argv[0]);
+            }
+            desc.capture.report_path = value;
+            i++;
+        } else if (!parse_count(arg, &desc.max_frames)) {
+            return usage(argv[0]);
+        }
+    }
+    // runs with a fixed frame count are measurements, never throttle them
+    state.allow_idle = (desc.max_frames == 0) && !desc.capture.enabled;
     desc.title       = "imgui-wgpu";
     wgpu_start(&desc);
     return 0;
@@ -0,0 +1,198 @@
+//------------------------------------------------------------------------------
+//  viewport.cpp
+//
+//  Offscreen simulation views with their own camera and culling.
+//------------------------------------------------------------------------------
+#include "viewport.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "profiler.hpp"
+
+namespace simly {
+
+// formats of the offscreen targets, the entity pipeline must match them
+static const sg_pixel_format ColorFormat = SG_PIXELFORMAT_RGBA8;
+static const sg_pixel_format DepthFormat = SG_PIXELFORMAT_DEPTH_STENCIL;
+// target sizes are rounded up to this, so views of similar size share
+// their transient targets and small resizes keep them
+static const int TargetGranularity = 64;
+
+static int round_up(int size) {
+    return ((size + TargetGranularity - 1) / TargetGranularity) *
+           TargetGranularity;
+}
+
+static float to_radians(float deg) { return deg * (3.14159265f / 180.0f); }
+
+static uint64_t hash_bytes(uint64_t h, const void *ptr, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)ptr;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return h;
+}
+
+template <typename T> static uint64_t hash_value(uint64_t h, const T &v) {
+    return hash_bytes(h, &v, sizeof(T));
+}
+
+void ViewCamera::orbit(float dx, float dy) {
+    longitude -= dx;
+    if (longitude < 0.0f) {
+        longitude += 360.0f;
+    }
+    if (longitude > 360.0f) {
+        longitude -= 360.0f;
+    }
+    latitude = std::min(std::max(latitude + dy, min_lat), max_lat);
+}
+
+void ViewCamera::zoom(float d) {
+    distance = std::min(std::max(distance + d, min_dist), max_dist);
+}
+
+EntityCamera ViewCamera::update(int fb_width, int fb_height) const {
+    assert((fb_width > 0) && (fb_height > 0));
+    const float lat    = to_radians(latitude);
+    const float lng    = to_radians(longitude);
+    const float eye[3] = {
+        center[0] + cosf(lat) * sinf(lng) * distance,
+        center[1] + sinf(lat) * distance,
+        center[2] + cosf(lat) * cosf(lng) * distance,
+    };
+    const float aspect = float(fb_width) / float(fb_height);
+    return EntityCamera::look_at(eye, center, to_radians(fovy), aspect, nearz,
+                                 farz);
+}
+
+void Viewport::init(const char *view_label, FrameRing &vertex_ring,
+                    int view_sample_count) {
+    assert(view_sample_count >= 1);
+    label        = view_label;
+    sample_count = view_sample_count;
+    entities.init(vertex_ring, ColorFormat, DepthFormat, sample_count);
+    pass_action.colors[0].load_action = SG_LOADACTION_CLEAR;
+    pass_action.colors[0].clear_value = {0.05f, 0.05f, 0.08f, 1.0f};
+    // the depth target is shared with other views, never keep its content
+    pass_action.depth.load_action  = SG_LOADACTION_CLEAR;
+    pass_action.depth.store_action = SG_STOREACTION_DONTCARE;
+}
+
+void Viewport::destroy_targets() {
+    if (atts.id != SG_INVALID_ID) {
+        sg_destroy_attachments(atts);
+    }
+    RenderTargetPool &pool = default_render_targets();
+    pool.release(depth_img);
+    pool.release(msaa_img);
+    pool.release(color_img);
+    atts          = {};
+    depth_img     = {};
+    msaa_img      = {};
+    color_img     = {};
+    target_width  = 0;
+    target_height = 0;
+    // pooled images may come back with someone else's content
+    rendered_key = 0;
+}
+
+void Viewport::shutdown() {
+    destroy_targets();
+    width  = 0;
+    height = 0;
+}
+
+void Viewport::resize(int new_width, int new_height) {
+    if ((new_width <= 0) || (new_height <= 0)) {
+        return;
+    }
+    width                 = new_width;
+    height                = new_height;
+    const int new_twidth  = round_up(width);
+    const int new_theight = round_up(height);
+    if ((new_twidth == target_width) && (new_theight == target_height)) {
+        return;
+    }
+    destroy_targets();
+    target_width  = new_twidth;
+    target_height = new_theight;
+
+    RenderTargetPool &pool = default_render_targets();
+    const int w            = target_width;
+    const int h            = target_height;
+    color_img = pool.acquire(w, h, ColorFormat, 1, false, label);
+    depth_img = pool.acquire(w, h, DepthFormat, sample_count, true,
+                             "view-depth");
+
+    sg_attachments_desc atts_desc = {};
+    if (sample_count > 1) {
+        msaa_img = pool.acquire(w, h, ColorFormat, sample_count, true,
+                                "view-msaa");
+        atts_desc.colors[0].image   = msaa_img;
+        atts_desc.resolves[0].image = color_img;
+    } else {
+        atts_desc.colors[0].image = color_img;
+    }
+    atts_desc.depth_stencil.image = depth_img;
+    atts_desc.label               = label;
+    atts                          = sg_make_attachments(&atts_desc);
+}
+
+size_t Viewport::prepare(const EntityColumns &columns, ThreadPool &pool) {
+    SIMLY_PROFILE_SCOPE("view prepare");
+    if (atts.id == SG_INVALID_ID) {
+        return 0;
+    }
+    const EntityCamera cam = camera.update(width, height);
+
+    // everything the image depends on, field by field so padding doesn't
+    // leak into the key
+    uint64_t h = 0xCBF29CE484222325ull;
+    h          = hash_bytes(h, cam.view_proj, sizeof(cam.view_proj));
+    h          = hash_bytes(h, cam.right, sizeof(cam.right));
+    h          = hash_bytes(h, cam.up, sizeof(cam.up));
+    h          = hash_value(h, color_img.id);
+    h          = hash_value(h, width);
+    h          = hash_value(h, height);
+    h          = hash_value(h, cull);
+    h          = hash_value(h, columns.x);
+    h          = hash_value(h, columns.y);
+    h          = hash_value(h, columns.z);
+    h          = hash_value(h, columns.scale);
+    h          = hash_value(h, columns.color);
+    h          = hash_value(h, columns.count);
+    h          = hash_value(h, columns.default_scale);
+    h          = hash_value(h, columns.default_color);
+    h          = hash_value(h, columns.version);
+    h          = hash_value(h, pass_action.colors[0].clear_value);
+    if (h == rendered_key) {
+        // the image (owned by the view, never cleared by others) is current
+        return entities.get_num_visible();
+    }
+    prepared     = true;
+    prepared_key = h;
+    return entities.prepare(columns, cam, cull, pool);
+}
+
+void Viewport::render() {
+    if (!prepared) {
+        return;
+    }
+    prepared     = false;
+    rendered_key = prepared_key;
+    SIMLY_PROFILE_SCOPE("view render");
+
+    sg_pass pass     = {};
+    pass.action      = pass_action;
+    pass.attachments = atts;
+    pass.label       = label;
+    sg_begin_pass(&pass);
+    sg_apply_viewport(0, 0, width, height, true);
+    entities.draw();
+    sg_end_pass();
+}
+
+} // namespace simly
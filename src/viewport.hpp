@@ -0,0 +1,115 @@
+#ifndef __VIEWPORT_HPP__
+#define __VIEWPORT_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+#include "entities.hpp"
+#include "frame_ring.hpp"
+#include "imgui.h"
+#include "parallel.hpp"
+#include "render_targets.hpp"
+#include "sokol_gfx.h"
+
+namespace simly {
+
+// Maya-style orbit camera with the parameters of camera_t from
+// libs/util/camera.h (angles in degrees), producing an EntityCamera
+// instead of HandmadeMath matrices.
+struct ViewCamera {
+    float center[3] = {};
+    float distance  = 5.0f;
+    float latitude  = 0.0f;
+    float longitude = 0.0f;
+    float fovy      = 60.0f;
+    float nearz     = 0.01f;
+    float farz      = 100.0f;
+    float min_dist  = 2.0f;
+    float max_dist  = 30.0f;
+    float min_lat   = -85.0f;
+    float max_lat   = 85.0f;
+
+    // feed mouse movement and zoom input, like cam_orbit() and cam_zoom()
+    void orbit(float dx, float dy);
+    void zoom(float d);
+
+    // like cam_update(), for a target of fb_width x fb_height pixels
+    EntityCamera update(int fb_width, int fb_height) const;
+};
+
+// One view of the simulation, rendered into its own offscreen target and
+// shown in the UI as an image. Every view culls the entity columns against
+// its own camera and packs only the entities it can see, so a closeup
+// doesn't pay for the whole population.
+//
+// Usage per frame: resize() and prepare() while building the UI (between
+// FrameRing::begin_frame() and commit()), render() after the ring was
+// committed and before the swapchain pass, the image then shows up where
+// get_texture() was passed to ImGui::Image() with get_uv_max().
+//
+// The targets come from the render target pool and are sized up to a
+// multiple of 64 pixels, the view renders into the top-left width x height
+// corner. Depth and MSAA color only live during the view's pass and are
+// shared by all views with the same target size; only the (resolved) color
+// image belongs to the view.
+class Viewport {
+  private:
+    sg_image color_img  = {};
+    sg_image msaa_img   = {};
+    sg_image depth_img  = {};
+    sg_attachments atts = {};
+    EntityRenderer entities;
+    const char *label = {};
+    int sample_count  = 1;
+    int width         = 0;
+    int height        = 0;
+    int target_width  = 0;
+    int target_height = 0;
+    bool prepared     = false;
+    // content of the view's image, and of the prepared entities
+    uint64_t rendered_key = 0;
+    uint64_t prepared_key = 0;
+
+    void destroy_targets();
+
+  public:
+    ViewCamera camera;
+    sg_pass_action pass_action = {};
+    bool cull                  = true;
+
+    // entity instances are uploaded through `vertex_ring`, sample_count > 1
+    // renders with MSAA and resolves into the view's image
+    void init(const char *label, FrameRing &vertex_ring, int sample_count = 1);
+    void shutdown();
+
+    // Sets the view size in pixels, the targets are only replaced if the
+    // size leaves their 64 pixel granularity.
+    void resize(int width, int height);
+
+    // Culls and packs the entities for this frame's render(). Nothing is
+    // prepared if the image already shows the same columns (by version),
+    // camera, target and clear color.
+    size_t prepare(const EntityColumns &columns,
+                   ThreadPool &pool = default_pool());
+
+    // true if render() will update the image this frame
+    bool needs_render() const { return prepared; }
+
+    // Renders the prepared entities into the offscreen target. Must be
+    // called outside of a pass; does nothing if nothing was prepared this
+    // frame.
+    void render();
+
+    ImTextureID get_texture() const {
+        return (ImTextureID)(uintptr_t)color_img.id;
+    }
+    ImVec2 get_uv_max() const {
+        return ImVec2(float(width) / float(target_width),
+                      float(height) / float(target_height));
+    }
+    size_t get_num_visible() const { return entities.get_num_visible(); }
+};
+
+} // namespace simly
+
+#endif // __VIEWPORT_HPP__
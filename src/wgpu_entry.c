@@ -4,6 +4,7 @@
 #include "wgpu_entry.h"
 #include <stdio.h>
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 
 static wgpu_state_t state;
@@ -15,11 +16,29 @@ void wgpu_start(const wgpu_desc_t* desc) {
     assert(desc->title);
     assert((desc->width > 0) && (desc->height > 0));
     assert(desc->init_cb && desc->frame_cb && desc->shutdown_cb);
+    assert(desc->max_fps >= 0);
+    assert(desc->max_frames >= 0);
 
     state.desc = *desc;
     state.width = state.desc.width;
     state.height = state.desc.height;
+    state.dpi_scale = 1.0f;
     state.desc.sample_count = wgpu_def(state.desc.sample_count, 1);
+#if defined(NDEBUG)
+    state.desc.validation = wgpu_def(state.desc.validation, WGPU_VALIDATION_TOGGLE);
+#else
+    state.desc.validation = wgpu_def(state.desc.validation, WGPU_VALIDATION_ALWAYS);
+#endif
+    state.desc.validation_interval = wgpu_def(state.desc.validation_interval, 60);
+    state.validation_enabled = (state.desc.validation != WGPU_VALIDATION_TOGGLE);
+    if (state.desc.capture.enabled) {
+        // measurements run unthrottled and end after the captured frames
+        assert(state.desc.capture.num_frames > 0);
+        assert(state.desc.capture.warmup_frames >= 0);
+        state.desc.max_fps = 0;
+        state.desc.max_frames = state.desc.capture.warmup_frames + state.desc.capture.num_frames;
+        wgpu_capture_setup(&state);
+    }
 
     wgpu_platform_start(&state);
 }
@@ -32,34 +51,207 @@ int wgpu_height(void) {
     return state.height;
 }
 
-void wgpu_key_down(wgpu_key_func fn) {
-    state.key_down_cb = fn;
+/* framebuffer pixels per CSS pixel (or window unit), 1 without desc.high_dpi */
+float wgpu_dpi_scale(void) {
+    return state.dpi_scale;
+}
+
+double wgpu_frame_interval(void) {
+    return state.pacer.frame_interval;
+}
+
+double wgpu_frame_jitter(void) {
+    return state.pacer.frame_jitter;
+}
+
+static bool wgpu_vsync(void) {
+#if defined(__EMSCRIPTEN__)
+    return true;
+#elif defined(SOKOL_DUMMY_BACKEND)
+    return false;
+#else
+    return (state.desc.present_mode == WGPU_PRESENTMODE_DEFAULT) || (state.desc.present_mode == WGPU_PRESENTMODE_FIFO);
+#endif
+}
+
+/*
+    The interval frames run at while they fit in milliseconds: the
+    desc.max_fps interval, with vsync no shorter than the display interval
+    (measured as the shortest sustained frame interval, so it also holds for
+    displays below 60 Hz). 0 without vsync and cap, frames run back to back.
+*/
+double wgpu_frame_budget(void) {
+    const double cap = (state.desc.max_fps > 0) ? (1000.0 / state.desc.max_fps) : 0.0;
+    if (!wgpu_vsync()) {
+        return cap;
+    }
+    return fmax(cap, state.pacer.min_frame_interval);
+}
+
+bool wgpu_capturing(void) {
+    return state.desc.capture.enabled;
+}
+
+void wgpu_capture_stage(const char* name, double ms) {
+    if (state.desc.capture.enabled) {
+        wgpu_capture_record(&state, name, ms);
+    }
+}
+
+/* only has an effect with WGPU_VALIDATION_TOGGLE */
+void wgpu_set_validation(bool enabled) {
+    if (state.desc.validation == WGPU_VALIDATION_TOGGLE) {
+        state.validation_enabled = enabled;
+    }
+}
+
+bool wgpu_validation(void) {
+    return state.validation_enabled;
+}
+
+wgpu_errors_t wgpu_errors(void) {
+    return state.errors;
+}
+
+#if !defined(SOKOL_DUMMY_BACKEND)
+static void wgpu_count_error(wgpu_state_t* state, WGPUErrorType type, const char* message) {
+    wgpu_errors_t* e = &state->errors;
+    if (type == WGPUErrorType_NoError) {
+        return;
+    }
+    if ((e->num_validation + e->num_out_of_memory + e->num_internal) == 0) {
+        fprintf(stderr, "ERROR: %s (further errors are only counted)\n", message);
+    }
+    switch (type) {
+        case WGPUErrorType_Validation:      e->num_validation++; break;
+        case WGPUErrorType_OutOfMemory:     e->num_out_of_memory++; break;
+        default:                            e->num_internal++; break;
+    }
+}
+
+/* callback of wgpuDevicePopErrorScope(), userdata is the wgpu_state_t */
+void wgpu_error_cb(WGPUErrorType type, const char* message, void* userdata) {
+    wgpu_count_error((wgpu_state_t*) userdata, type, message);
 }
 
-void wgpu_key_up(wgpu_key_func fn) {
-    state.key_up_cb = fn;
+void wgpu_uncaptured_error_cb(WGPUErrorType type, const char* message, void* userdata) {
+    wgpu_state_t* state = (wgpu_state_t*) userdata;
+    if (type != WGPUErrorType_NoError) {
+        state->errors.num_uncaptured++;
+    }
+    wgpu_count_error(state, type, message);
 }
 
-void wgpu_char(wgpu_char_func fn) {
-    state.char_cb = fn;
+/* pushes a validation scope if the policy wants this frame validated */
+void wgpu_validation_begin(wgpu_state_t* state) {
+    assert(!state->validation_scope);
+    bool validate = false;
+    switch (state->desc.validation) {
+        case WGPU_VALIDATION_INTERVAL:
+            validate = (state->frame_count % state->desc.validation_interval) == 0;
+            break;
+        default:
+            validate = state->validation_enabled;
+            break;
+    }
+    if (validate) {
+        wgpuDevicePushErrorScope(state->device, WGPUErrorFilter_Validation);
+        state->validation_scope = true;
+        state->errors.num_scopes++;
+    }
 }
 
-void wgpu_mouse_btn_down(wgpu_mouse_btn_func fn) {
-    state.mouse_btn_down_cb = fn;
+void wgpu_validation_end(wgpu_state_t* state) {
+    if (state->validation_scope) {
+        wgpuDevicePopErrorScope(state->device, wgpu_error_cb, state);
+        state->validation_scope = false;
+    }
 }
+#endif
 
-void wgpu_mouse_btn_up(wgpu_mouse_btn_func fn) {
-    state.mouse_btn_up_cb = fn;
+static double wgpu_ema(double avg, double val) {
+    return (avg == 0.0) ? val : (avg + 0.1 * (val - avg));
 }
 
-void wgpu_mouse_pos(wgpu_mouse_pos_func fn) {
-    state.mouse_pos_cb = fn;
+/*
+    Called by the platform code on every frame callback with the callback's
+    timestamp in milliseconds, returns false if the frame should be skipped
+    to honour desc.max_fps. Frames are scheduled on a fixed grid of
+    1000/max_fps ms, a frame runs on the callback closest to its deadline
+    (so a 30 fps cap on a 60 Hz display runs every other callback), and the
+    grid is resynced if the app falls behind by more than one interval.
+*/
+bool wgpu_pacer_tick(wgpu_state_t* state, double now) {
+    wgpu_pacer_t* p = &state->pacer;
+    if (p->last_tick > 0.0) {
+        p->tick_interval = wgpu_ema(p->tick_interval, now - p->last_tick);
+    }
+    p->last_tick = now;
+
+    if (state->desc.max_fps > 0) {
+        const double target = 1000.0 / state->desc.max_fps;
+        if ((now + 0.5 * p->tick_interval) < p->next_frame) {
+            return false;
+        }
+        p->next_frame += target;
+        if (p->next_frame < now) {
+            p->next_frame = now + target;
+        }
+    }
+
+    if (p->last_frame > 0.0) {
+        const double dt = now - p->last_frame;
+        p->frame_jitter = wgpu_ema(p->frame_jitter, fabs(dt - p->frame_interval));
+        p->frame_interval = wgpu_ema(p->frame_interval, dt);
+        // follows drops at once but rises only slowly, e.g. after the window moved to a slower display
+        if ((p->min_frame_interval == 0.0) || (p->frame_interval < p->min_frame_interval)) {
+            p->min_frame_interval = p->frame_interval;
+        } else {
+            p->min_frame_interval += 0.001 * (p->frame_interval - p->min_frame_interval);
+        }
+    }
+    p->last_frame = now;
+    return true;
 }
 
-void wgpu_mouse_wheel(wgpu_mouse_wheel_func fn) {
-    state.mouse_wheel_cb = fn;
+void wgpu_push_event(wgpu_state_t* state, const wgpu_event_t* event) {
+    assert(event && (event->type != WGPU_EVENTTYPE_INVALID));
+    wgpu_event_queue_t* q = &state->events;
+    if (q->count > 0) {
+        wgpu_event_t* last = &q->events[(q->head + q->count - 1) % WGPU_MAX_EVENTS];
+        if ((last->type == event->type) && (event->type == WGPU_EVENTTYPE_MOUSE_MOVE)) {
+            last->mouse_x = event->mouse_x;
+            last->mouse_y = event->mouse_y;
+            q->num_coalesced++;
+            return;
+        }
+        if ((last->type == event->type) && (event->type == WGPU_EVENTTYPE_MOUSE_WHEEL)) {
+            last->wheel += event->wheel;
+            q->num_coalesced++;
+            return;
+        }
+    }
+    if (q->count == WGPU_MAX_EVENTS) {
+        q->num_dropped++;
+        return;
+    }
+    q->events[(q->head + q->count) % WGPU_MAX_EVENTS] = *event;
+    q->count++;
+}
+
+bool wgpu_next_event(wgpu_event_t* out_event) {
+    assert(out_event);
+    wgpu_event_queue_t* q = &state.events;
+    if (q->count == 0) {
+        return false;
+    }
+    *out_event = q->events[q->head];
+    q->head = (q->head + 1) % WGPU_MAX_EVENTS;
+    q->count--;
+    return true;
 }
 
+#if !defined(SOKOL_DUMMY_BACKEND)
 static const void* wgpu_get_render_view(void) {
     if (state.desc.sample_count > 1) {
         assert(state.msaa_view);
@@ -82,13 +274,19 @@ static const void* wgpu_get_resolve_view(void) {
 static const void* wgpu_get_depth_stencil_view(void) {
     return (const void*) state.depth_stencil_view;
 }
+#endif
 
 static sg_pixel_format wgpu_get_color_format(void) {
+#if defined(SOKOL_DUMMY_BACKEND)
+    /* the null platform only describes a (non-existing) swapchain */
+    return SG_PIXELFORMAT_BGRA8;
+#else
     switch (state.render_format) {
         case WGPUTextureFormat_RGBA8Unorm:  return SG_PIXELFORMAT_RGBA8;
         case WGPUTextureFormat_BGRA8Unorm:  return SG_PIXELFORMAT_BGRA8;
         default: return SG_PIXELFORMAT_NONE;
     }
+#endif
 }
 
 static sg_pixel_format wgpu_get_depth_format(void) {
@@ -106,23 +304,44 @@ sg_environment wgpu_environment(void) {
             .depth_format = wgpu_get_depth_format(),
             .sample_count = state.desc.sample_count,
         },
+#if !defined(SOKOL_DUMMY_BACKEND)
         .wgpu = {
             .device = (const void*) state.device,
         }
+#endif
     };
 }
 
+/*
+    The current swapchain texture is only acquired on demand, so a frame
+    callback which never asks for the swapchain doesn't present anything
+    and the previous image stays on screen.
+*/
 sg_swapchain wgpu_swapchain(void) {
-    return (sg_swapchain) {
+    sg_swapchain swapchain = {
         .width = state.width,
         .height = state.height,
         .sample_count = state.desc.sample_count,
         .color_format = wgpu_get_color_format(),
         .depth_format = wgpu_get_depth_format(),
-        .wgpu = {
-            .render_view = wgpu_get_render_view(),
-            .resolve_view = wgpu_get_resolve_view(),
-            .depth_stencil_view = wgpu_get_depth_stencil_view(),
-        }
     };
+#if !defined(SOKOL_DUMMY_BACKEND)
+    if (!state.swapchain_view) {
+        if (state.capture.texture) {
+            state.swapchain_view = wgpuTextureCreateView(state.capture.texture, 0);
+        } else {
+            state.swapchain_view = wgpuSwapChainGetCurrentTextureView(state.swapchain);
+        }
+    }
+    swapchain.wgpu.render_view = wgpu_get_render_view();
+    swapchain.wgpu.resolve_view = wgpu_get_resolve_view();
+    swapchain.wgpu.depth_stencil_view = wgpu_get_depth_stencil_view();
+#endif
+    return swapchain;
+}
+
+/* counts a finished frame, returns false once desc.max_frames is reached */
+bool wgpu_frame_done(wgpu_state_t* state) {
+    state->frame_count++;
+    return (state->desc.max_frames == 0) || (state->frame_count < state->desc.max_frames);
 }
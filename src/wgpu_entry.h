@@ -1,16 +1,25 @@
 #pragma once
 /*
     Platform entry helper code for WebGPU samples.
+
+    Platforms: wgpu_entry_emsc.c (browser), wgpu_entry_dawn.cc (native
+    desktop through Dawn and GLFW) and wgpu_entry_null.c (no window and no
+    GPU, sokol-gfx must be compiled with SOKOL_DUMMY_BACKEND). The null
+    platform doesn't need the WebGPU headers, everything using WebGPU types
+    is left out with SOKOL_DUMMY_BACKEND.
 */
 #include <assert.h>
+#if !defined(SOKOL_DUMMY_BACKEND)
 #include <webgpu/webgpu.h>
+#endif
 #include "sokol_gfx.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// just the keys needed for the imgui sample
+// just the keys needed for the imgui sample, platforms may also pass
+// the letters 'A' to 'Z' through as their ASCII codes
 typedef enum {
     WGPU_KEY_INVALID = 0,
     WGPU_KEY_TAB,
@@ -26,39 +35,176 @@ typedef enum {
     WGPU_KEY_ESCAPE,
 } wgpu_keycode_t;
 
+// swapchain present modes, DEFAULT is FIFO; the browser always presents
+// with vsync and ignores the others
+typedef enum {
+    WGPU_PRESENTMODE_DEFAULT = 0,
+    WGPU_PRESENTMODE_FIFO,
+    WGPU_PRESENTMODE_MAILBOX,
+    WGPU_PRESENTMODE_IMMEDIATE,
+} wgpu_present_mode_t;
+
+/*
+    When frames run inside a validation error scope. Scopes cost an async
+    round trip per frame, so release builds default to TOGGLE (off until
+    wgpu_set_validation(true)), debug builds to ALWAYS.
+*/
+typedef enum {
+    WGPU_VALIDATION_DEFAULT = 0,
+    WGPU_VALIDATION_ALWAYS,
+    WGPU_VALIDATION_INTERVAL,   // every validation_interval-th frame
+    WGPU_VALIDATION_TOGGLE,
+} wgpu_validation_t;
+
+typedef void (*wgpu_preinit_func)(void);
 typedef void (*wgpu_init_func)(void);
 typedef void (*wgpu_frame_func)(void);
 typedef void (*wgpu_shutdown_func)(void);
-typedef void (*wgpu_key_func)(int key);
-typedef void (*wgpu_char_func)(uint32_t c);
-typedef void (*wgpu_mouse_btn_func)(int btn);
-typedef void (*wgpu_mouse_pos_func)(float x, float y);
-typedef void (*wgpu_mouse_wheel_func)(float v);
+
+/*
+    Capture mode for automated frame benchmarks: frames are rendered into an
+    offscreen texture instead of the swapchain (nothing is presented, the
+    size is fixed), the CPU time of every frame and of the app's stages
+    (see wgpu_capture_stage()) is recorded, and after warmup_frames +
+    num_frames frames a JSON report is written and the app quits.
+*/
+typedef struct {
+    bool enabled;
+    int num_frames;
+    int warmup_frames;
+    bool hash_images;           // read back and hash every measured frame, ignored by the dummy backend
+    const char* report_path;    // 0 for stdout, diagnostics go to stderr
+} wgpu_capture_desc_t;
 
 typedef struct {
     int width;
     int height;
     int sample_count;
     bool no_depth_buffer;
+    bool high_dpi;      // framebuffer at device pixels instead of CSS/window units
+    wgpu_present_mode_t present_mode;
+    int max_fps;        // 0 for no frame rate cap
+    int max_frames;     // quit after this many frames, 0 to run until closed
+    wgpu_validation_t validation;
+    int validation_interval;    // default 60
+    wgpu_capture_desc_t capture;
     const char* title;
+    /*
+        Optional CPU-only startup work (asset decoding, font baking, ...),
+        runs while the adapter and device are requested and must not touch
+        the GPU. init_cb is called once both are done and does the uploads.
+    */
+    wgpu_preinit_func preinit_cb;
     wgpu_init_func init_cb;
     wgpu_frame_func frame_cb;
     wgpu_shutdown_func shutdown_cb;
 } wgpu_desc_t;
 
+typedef enum {
+    WGPU_EVENTTYPE_INVALID = 0,
+    WGPU_EVENTTYPE_KEY_DOWN,
+    WGPU_EVENTTYPE_KEY_UP,
+    WGPU_EVENTTYPE_CHAR,
+    WGPU_EVENTTYPE_MOUSE_DOWN,
+    WGPU_EVENTTYPE_MOUSE_UP,
+    WGPU_EVENTTYPE_MOUSE_MOVE,
+    WGPU_EVENTTYPE_MOUSE_WHEEL,
+} wgpu_event_type_t;
+
+typedef struct {
+    wgpu_event_type_t type;
+    wgpu_keycode_t key;     // KEY_DOWN, KEY_UP
+    uint32_t char_code;     // CHAR
+    int mouse_button;       // MOUSE_DOWN, MOUSE_UP
+    float mouse_x;          // MOUSE_MOVE
+    float mouse_y;
+    float wheel;            // MOUSE_WHEEL
+} wgpu_event_t;
+
+/*
+    Input events are queued by the platform code and drained by the app once
+    per frame with wgpu_next_event(). Consecutive mouse moves (and wheel
+    deltas) are merged into one event, so a full queue means the app hasn't
+    drained it in a long time; new events are dropped then.
+*/
+#define WGPU_MAX_EVENTS (256)
+typedef struct {
+    wgpu_event_t events[WGPU_MAX_EVENTS];
+    int head;
+    int count;
+    int num_coalesced;
+    int num_dropped;
+} wgpu_event_queue_t;
+
+#define WGPU_CAPTURE_MAX_STAGES (16)
+#define WGPU_CAPTURE_MAX_READBACKS (4)
+#if !defined(SOKOL_DUMMY_BACKEND)
+typedef struct {
+    WGPUBuffer buffer;
+    bool busy;
+    uint64_t* out_hash;
+    int row_bytes;
+    int bytes_per_row;
+    int height;
+} wgpu_readback_t;
+#endif
+
+typedef struct {
+    int num_stages;
+    const char* stage_names[WGPU_CAPTURE_MAX_STAGES];
+    double* stage_samples[WGPU_CAPTURE_MAX_STAGES];   // ms, one per measured frame
+    uint64_t* hashes;
+#if !defined(SOKOL_DUMMY_BACKEND)
+    WGPUTexture texture;
+    wgpu_readback_t readbacks[WGPU_CAPTURE_MAX_READBACKS];
+#endif
+} wgpu_capture_t;
+
+/*
+    WebGPU errors are counted instead of logged, only the first one of a run
+    is printed. Uncaptured errors happen outside of validation scopes.
+*/
+typedef struct {
+    int num_validation;
+    int num_out_of_memory;
+    int num_internal;
+    int num_uncaptured;
+    int num_scopes;         // frames that ran inside a validation scope
+} wgpu_errors_t;
+
+// frame pacer, times in milliseconds
+typedef struct {
+    double last_tick;
+    double last_frame;
+    double next_frame;
+    double tick_interval;   // smoothed interval of the platform frame callback
+    double frame_interval;  // smoothed interval of the frames actually run
+    double frame_jitter;    // smoothed deviation from frame_interval
+    double min_frame_interval;  // shortest sustained frame_interval
+} wgpu_pacer_t;
+
 typedef struct {
     wgpu_desc_t desc;
     bool async_setup_failed;
     bool async_setup_done;
+    int frame_count;
     int width;
     int height;
-    wgpu_key_func key_down_cb;
-    wgpu_key_func key_up_cb;
-    wgpu_char_func char_cb;
-    wgpu_mouse_btn_func mouse_btn_down_cb;
-    wgpu_mouse_btn_func mouse_btn_up_cb;
-    wgpu_mouse_pos_func mouse_pos_cb;
-    wgpu_mouse_wheel_func mouse_wheel_cb;
+    float dpi_scale;
+    bool resize_pending;
+    int pending_width;
+    int pending_height;
+    int attachments_width;
+    int attachments_height;
+    int attachments_sample_count;
+    wgpu_pacer_t pacer;
+    wgpu_errors_t errors;
+    bool validation_enabled;
+    bool validation_scope;
+    wgpu_capture_t capture;
+    bool finishing;
+    wgpu_event_queue_t events;
+#if !defined(SOKOL_DUMMY_BACKEND)
     WGPUInstance instance;
     WGPUAdapter adapter;
     WGPUDevice device;
@@ -70,24 +216,46 @@ typedef struct {
     WGPUTextureView swapchain_view;
     WGPUTextureView msaa_view;
     WGPUTextureView depth_stencil_view;
+#endif
 } wgpu_state_t;
 
 void wgpu_start(const wgpu_desc_t* desc);
 int wgpu_width(void);
 int wgpu_height(void);
+float wgpu_dpi_scale(void);
+double wgpu_frame_interval(void);
+double wgpu_frame_jitter(void);
+double wgpu_frame_budget(void);
+bool wgpu_capturing(void);
+void wgpu_set_validation(bool enabled);
+bool wgpu_validation(void);
+wgpu_errors_t wgpu_errors(void);
+void wgpu_capture_stage(const char* name, double ms);
 sg_environment wgpu_environment(void);
 sg_swapchain wgpu_swapchain(void);
-void wgpu_key_down(wgpu_key_func fn);
-void wgpu_key_up(wgpu_key_func fn);
-void wgpu_char(wgpu_char_func fn);
-void wgpu_mouse_btn_down(wgpu_mouse_btn_func fn);
-void wgpu_mouse_btn_up(wgpu_mouse_btn_func fn);
-void wgpu_mouse_pos(wgpu_mouse_pos_func fn);
-void wgpu_mouse_wheel(wgpu_mouse_wheel_func fn);
+bool wgpu_next_event(wgpu_event_t* out_event);
 
 // internal functions, don't call
 void wgpu_swapchain_init(wgpu_state_t* state);
 void wgpu_swapchain_discard(wgpu_state_t* state);
+void wgpu_swapchain_resize(wgpu_state_t* state, int width, int height);
+bool wgpu_pacer_tick(wgpu_state_t* state, double now);
+void wgpu_push_event(wgpu_state_t* state, const wgpu_event_t* event);
+bool wgpu_frame_done(wgpu_state_t* state);
+#if !defined(SOKOL_DUMMY_BACKEND)
+void wgpu_error_cb(WGPUErrorType type, const char* message, void* userdata);
+void wgpu_uncaptured_error_cb(WGPUErrorType type, const char* message, void* userdata);
+void wgpu_validation_begin(wgpu_state_t* state);
+void wgpu_validation_end(wgpu_state_t* state);
+void wgpu_capture_init_target(wgpu_state_t* state);
+void wgpu_capture_discard(wgpu_state_t* state);
+#endif
+void wgpu_capture_setup(wgpu_state_t* state);
+void wgpu_capture_record(wgpu_state_t* state, const char* name, double ms);
+bool wgpu_capture_ready(wgpu_state_t* state);
+void wgpu_capture_frame(wgpu_state_t* state, double frame_ms);
+bool wgpu_capture_finished(wgpu_state_t* state);
+void wgpu_capture_report(wgpu_state_t* state);
 void wgpu_platform_start(wgpu_state_t* state);
 
 #ifdef __cplusplus
@@ -0,0 +1,261 @@
+//------------------------------------------------------------------------------
+//  wgpu_entry_capture.c
+//
+//  Capture mode: offscreen frames, per-stage CPU timings, optional image
+//  hashes and the JSON report.
+//------------------------------------------------------------------------------
+#include "wgpu_entry.h"
+#include <stdio.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// index of the frame being run among the measured frames, -1 in warmup
+static int wgpu_capture_index(const wgpu_state_t* state) {
+    const int index = state->frame_count - state->desc.capture.warmup_frames;
+    return (index < state->desc.capture.num_frames) ? index : -1;
+}
+
+void wgpu_capture_setup(wgpu_state_t* state) {
+    const int num_frames = state->desc.capture.num_frames;
+#if defined(SOKOL_DUMMY_BACKEND)
+    // nothing is rendered to hash, the report leaves out the image hashes
+    if (state->desc.capture.hash_images) {
+        fprintf(stderr, "image hashes need a GPU backend, ignoring hash_images\n");
+        state->desc.capture.hash_images = false;
+    }
+#endif
+    if (state->desc.capture.hash_images) {
+        state->capture.hashes = (uint64_t*) calloc((size_t)num_frames, sizeof(uint64_t));
+    }
+    // the first stage is the whole frame callback
+    wgpu_capture_record(state, "frame", -1.0);
+}
+
+void wgpu_capture_record(wgpu_state_t* state, const char* name, double ms) {
+    wgpu_capture_t* cap = &state->capture;
+    int stage = 0;
+    while ((stage < cap->num_stages) && (0 != strcmp(cap->stage_names[stage], name))) {
+        stage++;
+    }
+    if (stage == cap->num_stages) {
+        if (stage == WGPU_CAPTURE_MAX_STAGES) {
+            return;
+        }
+        cap->stage_names[stage] = name;
+        cap->stage_samples[stage] = (double*) calloc((size_t)state->desc.capture.num_frames, sizeof(double));
+        cap->num_stages++;
+    }
+    const int index = wgpu_capture_index(state);
+    if ((index >= 0) && (ms >= 0.0)) {
+        // a stage may run more than once per frame
+        cap->stage_samples[stage][index] += ms;
+    }
+}
+
+#if !defined(SOKOL_DUMMY_BACKEND)
+static uint64_t wgpu_hash_rows(const uint8_t* ptr, int row_bytes, int bytes_per_row, int height) {
+    uint64_t h = 0xCBF29CE484222325ull;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = ptr + (size_t)y * (size_t)bytes_per_row;
+        for (int x = 0; x < row_bytes; x++) {
+            h = (h ^ row[x]) * 0x100000001B3ull;
+        }
+    }
+    return h;
+}
+
+void wgpu_capture_init_target(wgpu_state_t* state) {
+    assert(0 == state->capture.texture);
+    state->capture.texture = wgpuDeviceCreateTexture(state->device, &(WGPUTextureDescriptor){
+        .usage = WGPUTextureUsage_RenderAttachment | WGPUTextureUsage_CopySrc,
+        .dimension = WGPUTextureDimension_2D,
+        .size = {
+            .width = (uint32_t) state->width,
+            .height = (uint32_t) state->height,
+            .depthOrArrayLayers = 1,
+        },
+        .format = state->render_format,
+        .mipLevelCount = 1,
+        .sampleCount = 1,
+    });
+    assert(state->capture.texture);
+}
+
+void wgpu_capture_discard(wgpu_state_t* state) {
+    for (int i = 0; i < WGPU_CAPTURE_MAX_READBACKS; i++) {
+        wgpu_readback_t* rb = &state->capture.readbacks[i];
+        if (rb->buffer) {
+            wgpuBufferRelease(rb->buffer);
+            rb->buffer = 0;
+        }
+    }
+    if (state->capture.texture) {
+        wgpuTextureRelease(state->capture.texture);
+        state->capture.texture = 0;
+    }
+}
+
+static void wgpu_readback_cb(WGPUBufferMapAsyncStatus status, void* userdata) {
+    wgpu_readback_t* rb = (wgpu_readback_t*) userdata;
+    if (status == WGPUBufferMapAsyncStatus_Success) {
+        const size_t size = (size_t)rb->bytes_per_row * (size_t)rb->height;
+        const uint8_t* ptr = (const uint8_t*) wgpuBufferGetConstMappedRange(rb->buffer, 0, size);
+        *rb->out_hash = wgpu_hash_rows(ptr, rb->row_bytes, rb->bytes_per_row, rb->height);
+        wgpuBufferUnmap(rb->buffer);
+    }
+    rb->busy = false;
+}
+
+static wgpu_readback_t* wgpu_free_readback(wgpu_state_t* state) {
+    for (int i = 0; i < WGPU_CAPTURE_MAX_READBACKS; i++) {
+        if (!state->capture.readbacks[i].busy) {
+            return &state->capture.readbacks[i];
+        }
+    }
+    return 0;
+}
+
+/* copy the frame into a mappable buffer, the hash is computed when the map completes */
+static void wgpu_capture_readback(wgpu_state_t* state, uint64_t* out_hash) {
+    wgpu_readback_t* rb = wgpu_free_readback(state);
+    assert(rb);
+    rb->out_hash = out_hash;
+    rb->row_bytes = state->width * 4;
+    rb->bytes_per_row = (rb->row_bytes + 255) & ~255;
+    rb->height = state->height;
+    const size_t size = (size_t)rb->bytes_per_row * (size_t)rb->height;
+    if (!rb->buffer) {
+        rb->buffer = wgpuDeviceCreateBuffer(state->device, &(WGPUBufferDescriptor){
+            .usage = WGPUBufferUsage_MapRead | WGPUBufferUsage_CopyDst,
+            .size = size,
+        });
+        assert(rb->buffer);
+    }
+    WGPUCommandEncoder enc = wgpuDeviceCreateCommandEncoder(state->device, &(WGPUCommandEncoderDescriptor){0});
+    wgpuCommandEncoderCopyTextureToBuffer(enc,
+        &(WGPUImageCopyTexture){ .texture = state->capture.texture },
+        &(WGPUImageCopyBuffer){
+            .layout = {
+                .bytesPerRow = (uint32_t) rb->bytes_per_row,
+                .rowsPerImage = (uint32_t) rb->height,
+            },
+            .buffer = rb->buffer,
+        },
+        &(WGPUExtent3D){ (uint32_t) state->width, (uint32_t) state->height, 1 });
+    WGPUCommandBuffer cmd_buf = wgpuCommandEncoderFinish(enc, 0);
+    WGPUQueue queue = wgpuDeviceGetQueue(state->device);
+    wgpuQueueSubmit(queue, 1, &cmd_buf);
+    wgpuQueueRelease(queue);
+    wgpuCommandBufferRelease(cmd_buf);
+    wgpuCommandEncoderRelease(enc);
+    rb->busy = true;
+    wgpuBufferMapAsync(rb->buffer, WGPUMapMode_Read, 0, size, wgpu_readback_cb, rb);
+}
+#endif
+
+/* false while hashing and all readback buffers are in flight, the frame has to wait */
+bool wgpu_capture_ready(wgpu_state_t* state) {
+#if !defined(SOKOL_DUMMY_BACKEND)
+    if (state->desc.capture.enabled && state->desc.capture.hash_images) {
+        return 0 != wgpu_free_readback(state);
+    }
+#else
+    (void)state;
+#endif
+    return true;
+}
+
+/* call after the frame callback (and after its commands were submitted) */
+void wgpu_capture_frame(wgpu_state_t* state, double frame_ms) {
+    if (!state->desc.capture.enabled) {
+        return;
+    }
+    wgpu_capture_record(state, "frame", frame_ms);
+#if !defined(SOKOL_DUMMY_BACKEND)
+    const int index = wgpu_capture_index(state);
+    if ((index >= 0) && state->desc.capture.hash_images && state->capture.texture) {
+        wgpu_capture_readback(state, &state->capture.hashes[index]);
+    }
+#endif
+}
+
+bool wgpu_capture_finished(wgpu_state_t* state) {
+#if !defined(SOKOL_DUMMY_BACKEND)
+    for (int i = 0; i < WGPU_CAPTURE_MAX_READBACKS; i++) {
+        if (state->capture.readbacks[i].busy) {
+            return false;
+        }
+    }
+#else
+    (void)state;
+#endif
+    return true;
+}
+
+static int wgpu_cmp_double(const void* a, const void* b) {
+    const double da = *(const double*)a;
+    const double db = *(const double*)b;
+    return (da < db) ? -1 : ((da > db) ? 1 : 0);
+}
+
+static void wgpu_capture_free(wgpu_capture_t* cap) {
+    for (int s = 0; s < cap->num_stages; s++) {
+        free(cap->stage_samples[s]);
+        cap->stage_samples[s] = 0;
+    }
+    cap->num_stages = 0;
+    free(cap->hashes);
+    cap->hashes = 0;
+}
+
+void wgpu_capture_report(wgpu_state_t* state) {
+    if (!state->desc.capture.enabled) {
+        return;
+    }
+    const wgpu_capture_desc_t* desc = &state->desc.capture;
+    wgpu_capture_t* cap = &state->capture;
+    // stdout only carries the report, all diagnostics go to stderr
+    FILE* fp = desc->report_path ? fopen(desc->report_path, "w") : stdout;
+    if (!fp) {
+        fprintf(stderr, "failed to open capture report '%s'\n", desc->report_path);
+        wgpu_capture_free(cap);
+        return;
+    }
+    const int n = desc->num_frames;
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"frames\": %d,\n", n);
+    fprintf(fp, "  \"warmup_frames\": %d,\n", desc->warmup_frames);
+    fprintf(fp, "  \"width\": %d,\n", state->width);
+    fprintf(fp, "  \"height\": %d,\n", state->height);
+    fprintf(fp, "  \"sample_count\": %d,\n", state->desc.sample_count);
+    fprintf(fp, "  \"stages\": [\n");
+    double* sorted = (double*) malloc((size_t)n * sizeof(double));
+    for (int s = 0; s < cap->num_stages; s++) {
+        memcpy(sorted, cap->stage_samples[s], (size_t)n * sizeof(double));
+        qsort(sorted, (size_t)n, sizeof(double), wgpu_cmp_double);
+        double sum = 0.0;
+        for (int i = 0; i < n; i++) {
+            sum += sorted[i];
+        }
+        fprintf(fp, "    { \"name\": \"%s\", \"mean_ms\": %.4f, \"min_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, \"max_ms\": %.4f }%s\n",
+            cap->stage_names[s], sum / n, sorted[0], sorted[n / 2], sorted[(n * 95) / 100], sorted[n - 1],
+            (s + 1 < cap->num_stages) ? "," : "");
+    }
+    free(sorted);
+    fprintf(fp, "  ]");
+    if (cap->hashes) {
+        fprintf(fp, ",\n  \"image_hashes\": [");
+        for (int i = 0; i < n; i++) {
+            fprintf(fp, "%s\"%016llx\"", (i > 0) ? ", " : "", (unsigned long long) cap->hashes[i]);
+        }
+        fprintf(fp, "]");
+    }
+    fprintf(fp, "\n}\n");
+    if (fp != stdout) {
+        fclose(fp);
+    } else {
+        fflush(fp);
+    }
+    wgpu_capture_free(cap);
+}
@@ -0,0 +1,267 @@
+//------------------------------------------------------------------------------
+//  wgpu_entry_dawn.cc
+//
+//  Dawn-specific WebGPU scaffolding for native desktop builds, the window
+//  and input come from GLFW.
+//------------------------------------------------------------------------------
+#include <stdio.h>
+#include <assert.h>
+#include <memory>
+#include <thread>
+#include "GLFW/glfw3.h"
+#include "webgpu/webgpu_glfw.h"
+#include "wgpu_entry.h"
+
+static void request_adapter_cb(WGPURequestAdapterStatus status, WGPUAdapter adapter, const char* msg, void* userdata) {
+    wgpu_state_t* state = (wgpu_state_t*) userdata;
+    if (status != WGPURequestAdapterStatus_Success) {
+        fprintf(stderr, "wgpuInstanceRequestAdapter failed with %s!\n", msg);
+        state->async_setup_failed = true;
+        return;
+    }
+    state->adapter = adapter;
+}
+
+static void request_device_cb(WGPURequestDeviceStatus status, WGPUDevice device, const char* msg, void* userdata) {
+    wgpu_state_t* state = (wgpu_state_t*) userdata;
+    if (status != WGPURequestDeviceStatus_Success) {
+        fprintf(stderr, "wgpuAdapterRequestDevice failed with %s!\n", msg);
+        state->async_setup_failed = true;
+        return;
+    }
+    state->device = device;
+    wgpuDeviceSetUncapturedErrorCallback(state->device, wgpu_uncaptured_error_cb, state);
+}
+
+static wgpu_keycode_t glfw_translate_key(int key) {
+    switch (key) {
+        case GLFW_KEY_TAB:          return WGPU_KEY_TAB;
+        case GLFW_KEY_LEFT:         return WGPU_KEY_LEFT;
+        case GLFW_KEY_RIGHT:        return WGPU_KEY_RIGHT;
+        case GLFW_KEY_UP:           return WGPU_KEY_UP;
+        case GLFW_KEY_DOWN:         return WGPU_KEY_DOWN;
+        case GLFW_KEY_HOME:         return WGPU_KEY_HOME;
+        case GLFW_KEY_END:          return WGPU_KEY_END;
+        case GLFW_KEY_DELETE:       return WGPU_KEY_DELETE;
+        case GLFW_KEY_BACKSPACE:    return WGPU_KEY_BACKSPACE;
+        case GLFW_KEY_ENTER:        return WGPU_KEY_ENTER;
+        case GLFW_KEY_ESCAPE:       return WGPU_KEY_ESCAPE;
+        default:
+            // GLFW_KEY_A..GLFW_KEY_Z are the ASCII codes
+            if ((key >= GLFW_KEY_A) && (key <= GLFW_KEY_Z)) {
+                return (wgpu_keycode_t) key;
+            }
+            return WGPU_KEY_INVALID;
+    }
+}
+
+static void glfw_key_cb(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    (void)scancode; (void)mods;
+    wgpu_state_t* state = (wgpu_state_t*) glfwGetWindowUserPointer(window);
+    const wgpu_keycode_t wgpu_key = glfw_translate_key(key);
+    if (WGPU_KEY_INVALID == wgpu_key) {
+        return;
+    }
+    wgpu_event_t ev = {};
+    ev.type = (action == GLFW_RELEASE) ? WGPU_EVENTTYPE_KEY_UP : WGPU_EVENTTYPE_KEY_DOWN;
+    ev.key = wgpu_key;
+    wgpu_push_event(state, &ev);
+}
+
+static void glfw_char_cb(GLFWwindow* window, unsigned int chr) {
+    wgpu_state_t* state = (wgpu_state_t*) glfwGetWindowUserPointer(window);
+    wgpu_event_t ev = {};
+    ev.type = WGPU_EVENTTYPE_CHAR;
+    ev.char_code = chr;
+    wgpu_push_event(state, &ev);
+}
+
+static void glfw_mousebutton_cb(GLFWwindow* window, int button, int action, int mods) {
+    (void)mods;
+    wgpu_state_t* state = (wgpu_state_t*) glfwGetWindowUserPointer(window);
+    if (button < 3) {
+        wgpu_event_t ev = {};
+        ev.type = (action == GLFW_PRESS) ? WGPU_EVENTTYPE_MOUSE_DOWN : WGPU_EVENTTYPE_MOUSE_UP;
+        ev.mouse_button = button;
+        wgpu_push_event(state, &ev);
+    }
+}
+
+static void glfw_cursorpos_cb(GLFWwindow* window, double x, double y) {
+    wgpu_state_t* state = (wgpu_state_t*) glfwGetWindowUserPointer(window);
+    // window units to framebuffer pixels, they differ on macOS retina displays
+    int win_width, win_height;
+    glfwGetWindowSize(window, &win_width, &win_height);
+    const float sx = (win_width > 0) ? (float) state->width / (float) win_width : 1.0f;
+    const float sy = (win_height > 0) ? (float) state->height / (float) win_height : 1.0f;
+    wgpu_event_t ev = {};
+    ev.type = WGPU_EVENTTYPE_MOUSE_MOVE;
+    ev.mouse_x = (float) x * sx;
+    ev.mouse_y = (float) y * sy;
+    wgpu_push_event(state, &ev);
+}
+
+static void glfw_scroll_cb(GLFWwindow* window, double x, double y) {
+    (void)x;
+    wgpu_state_t* state = (wgpu_state_t*) glfwGetWindowUserPointer(window);
+    wgpu_event_t ev = {};
+    ev.type = WGPU_EVENTTYPE_MOUSE_WHEEL;
+    ev.wheel = (float) y;
+    wgpu_push_event(state, &ev);
+}
+
+/* like on the web, resizes are only recorded and applied at the next frame */
+static void glfw_framebuffer_size_cb(GLFWwindow* window, int width, int height) {
+    wgpu_state_t* state = (wgpu_state_t*) glfwGetWindowUserPointer(window);
+    state->pending_width = width;
+    state->pending_height = height;
+    state->resize_pending = true;
+}
+
+/* the app rebuilds its UI scale and fonts when it sees the new value */
+static void glfw_content_scale_cb(GLFWwindow* window, float xscale, float yscale) {
+    (void)yscale;
+    wgpu_state_t* state = (wgpu_state_t*) glfwGetWindowUserPointer(window);
+    state->dpi_scale = xscale;
+}
+
+void wgpu_platform_start(wgpu_state_t* state) {
+    assert(state->instance == 0);
+
+    // the UI scale has to be known before preinit bakes the fonts
+    glfwInit();
+    if (state->desc.high_dpi) {
+        float yscale;
+        glfwGetMonitorContentScale(glfwGetPrimaryMonitor(), &state->dpi_scale, &yscale);
+    }
+
+    // the CPU side of the startup runs on its own thread while the adapter,
+    // the device and the window are created
+    std::thread preinit;
+    if (state->desc.preinit_cb) {
+        preinit = std::thread(state->desc.preinit_cb);
+    }
+
+    state->instance = wgpuCreateInstance(0);
+    assert(state->instance);
+    // Dawn fires the request callbacks from wgpuInstanceProcessEvents()
+    wgpuInstanceRequestAdapter(state->instance, 0, request_adapter_cb, state);
+    while (!state->adapter && !state->async_setup_failed) {
+        wgpuInstanceProcessEvents(state->instance);
+    }
+    if (state->async_setup_failed) {
+        if (preinit.joinable()) {
+            preinit.join();
+        }
+        glfwTerminate();
+        return;
+    }
+    WGPUFeatureName required_features[1] = {
+        WGPUFeatureName_Depth32FloatStencil8
+    };
+    WGPUDeviceDescriptor dev_desc = {};
+    dev_desc.requiredFeatureCount = 1;
+    dev_desc.requiredFeatures = required_features;
+    wgpuAdapterRequestDevice(state->adapter, &dev_desc, request_device_cb, state);
+    while (!state->device && !state->async_setup_failed) {
+        wgpuInstanceProcessEvents(state->instance);
+    }
+    if (state->async_setup_failed) {
+        if (preinit.joinable()) {
+            preinit.join();
+        }
+        glfwTerminate();
+        return;
+    }
+
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    glfwWindowHint(GLFW_SCALE_TO_MONITOR, state->desc.high_dpi ? GLFW_TRUE : GLFW_FALSE);
+    glfwWindowHint(GLFW_COCOA_RETINA_FRAMEBUFFER, state->desc.high_dpi ? GLFW_TRUE : GLFW_FALSE);
+    // capture mode only needs the window for the surface format
+    glfwWindowHint(GLFW_VISIBLE, state->desc.capture.enabled ? GLFW_FALSE : GLFW_TRUE);
+    GLFWwindow* window = glfwCreateWindow(state->width, state->height, state->desc.title, 0, 0);
+    assert(window);
+    glfwSetWindowUserPointer(window, state);
+    glfwSetKeyCallback(window, glfw_key_cb);
+    glfwSetCharCallback(window, glfw_char_cb);
+    glfwSetMouseButtonCallback(window, glfw_mousebutton_cb);
+    glfwSetCursorPosCallback(window, glfw_cursorpos_cb);
+    glfwSetScrollCallback(window, glfw_scroll_cb);
+    if (!state->desc.capture.enabled) {
+        glfwSetFramebufferSizeCallback(window, glfw_framebuffer_size_cb);
+    }
+    if (state->desc.high_dpi) {
+        glfwSetWindowContentScaleCallback(window, glfw_content_scale_cb);
+    }
+    glfwGetFramebufferSize(window, &state->width, &state->height);
+
+    std::unique_ptr<wgpu::ChainedStruct> surf_chain = wgpu::glfw::SetupWindowAndGetSurfaceDescriptor(window);
+    WGPUSurfaceDescriptor surf_desc = {};
+    surf_desc.nextInChain = (const WGPUChainedStruct*) surf_chain.get();
+    state->surface = wgpuInstanceCreateSurface(state->instance, &surf_desc);
+    assert(state->surface);
+    state->render_format = wgpuSurfaceGetPreferredFormat(state->surface, state->adapter);
+
+    wgpu_swapchain_init(state);
+    if (preinit.joinable()) {
+        preinit.join();
+    }
+    // setup always runs validated
+    wgpuDevicePushErrorScope(state->device, WGPUErrorFilter_Validation);
+    state->desc.init_cb();
+    wgpuDevicePopErrorScope(state->device, wgpu_error_cb, state);
+    state->async_setup_done = true;
+
+    bool running = true;
+    while (running && !glfwWindowShouldClose(window)) {
+        glfwPollEvents();
+        wgpuInstanceProcessEvents(state->instance);
+        // a minimized window has a zero sized framebuffer, keep the old size
+        if (state->resize_pending && (state->pending_width > 0) && (state->pending_height > 0)) {
+            state->resize_pending = false;
+            wgpu_swapchain_resize(state, state->pending_width, state->pending_height);
+        }
+        if (!wgpu_capture_ready(state)) {
+            continue;
+        }
+        if (!wgpu_pacer_tick(state, glfwGetTime() * 1000.0)) {
+            glfwWaitEventsTimeout(0.001);
+            continue;
+        }
+        wgpu_validation_begin(state);
+        const double frame_start = glfwGetTime();
+        state->desc.frame_cb();
+        wgpu_capture_frame(state, (glfwGetTime() - frame_start) * 1000.0);
+        wgpu_validation_end(state);
+        if (state->swapchain_view) {
+            if (state->swapchain) {
+                wgpuSwapChainPresent(state->swapchain);
+            }
+            wgpuTextureViewRelease(state->swapchain_view);
+            state->swapchain_view = 0;
+        } else if (!state->desc.capture.enabled) {
+            // nothing presented (e.g. UI idle), there's no vsync to wait
+            // for, so block on input like a browser would until the next
+            // animation frame
+            glfwWaitEventsTimeout(1.0 / 60.0);
+        }
+        running = wgpu_frame_done(state);
+    }
+    while (!wgpu_capture_finished(state)) {
+        wgpuInstanceProcessEvents(state->instance);
+    }
+    wgpu_capture_report(state);
+    state->desc.shutdown_cb();
+
+    wgpu_swapchain_discard(state);
+    wgpuSurfaceRelease(state->surface);
+    state->surface = 0;
+    wgpuDeviceRelease(state->device);
+    state->device = 0;
+    wgpuAdapterRelease(state->adapter);
+    state->adapter = 0;
+    wgpuInstanceRelease(state->instance);
+    state->instance = 0;
+    glfwDestroyWindow(window);
+    glfwTerminate();
+}
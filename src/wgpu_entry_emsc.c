@@ -1,7 +1,7 @@
 //------------------------------------------------------------------------------
 //  wgpu_entry_emsc.c
-//  Emscripten-specific WebGPU scaffolding. NOTE: does not scale the swapchain
-//  surfaces when the window size changes.
+//  Emscripten-specific WebGPU scaffolding. Canvas resizes are collected
+//  from the resize events and applied once at the next frame boundary.
 //------------------------------------------------------------------------------
 #include <stdio.h>
 #include <assert.h>
@@ -10,22 +10,54 @@
 #include <emscripten/html5.h>
 #include "wgpu_entry.h"
 
+/* with desc.high_dpi the canvas is backed by device pixels */
+static float emsc_dpi_scale(const wgpu_state_t* state) {
+    return state->desc.high_dpi ? (float) emscripten_get_device_pixel_ratio() : 1.0f;
+}
+
 static void emsc_update_canvas_size(wgpu_state_t* state) {
     double w, h;
     emscripten_get_element_css_size("#canvas", &w, &h);
-    emscripten_set_canvas_element_size("#canvas", w, h);
-    state->width = (int) w;
-    state->height = (int) h;
-    printf("canvas size updated: %d %d\n", state->width, state->height);
+    state->dpi_scale = emsc_dpi_scale(state);
+    state->width = (int) (w * state->dpi_scale);
+    state->height = (int) (h * state->dpi_scale);
+    emscripten_set_canvas_element_size("#canvas", state->width, state->height);
+    fprintf(stderr, "canvas size updated: %d %d (dpi scale %.2f)\n", state->width, state->height, state->dpi_scale);
 }
 
+/*
+    Resize events only record the new size, a window being dragged fires
+    many of them per frame. The last one wins in emsc_apply_resize().
+*/
 static EM_BOOL emsc_size_changed(int event_type, const EmscriptenUiEvent* ui_event, void* userdata) {
     (void)event_type; (void)ui_event;
     wgpu_state_t* state = userdata;
-    emsc_update_canvas_size(state);
+    double w, h;
+    emscripten_get_element_css_size("#canvas", &w, &h);
+    state->pending_width = (int) w;
+    state->pending_height = (int) h;
+    state->resize_pending = true;
     return true;
 }
 
+/*
+    Called at a frame boundary, the canvas and the swapchain change together.
+    The pending size is in CSS pixels, a browser zoom changes the device
+    pixel ratio and also fires a resize event.
+*/
+static void emsc_apply_resize(wgpu_state_t* state) {
+    state->resize_pending = false;
+    state->dpi_scale = emsc_dpi_scale(state);
+    const int w = (int) (state->pending_width * state->dpi_scale);
+    const int h = (int) (state->pending_height * state->dpi_scale);
+    if ((w <= 0) || (h <= 0) || ((w == state->width) && (h == state->height))) {
+        return;
+    }
+    emscripten_set_canvas_element_size("#canvas", w, h);
+    wgpu_swapchain_resize(state, w, h);
+    fprintf(stderr, "canvas size updated: %d %d (dpi scale %.2f)\n", state->width, state->height, state->dpi_scale);
+}
+
 static struct {
     const char* str;
     wgpu_keycode_t code;
@@ -44,14 +76,39 @@ static struct {
     { 0, WGPU_KEY_INVALID },
 };
 
+/* open addressing hash table over emsc_keymap, filled by emsc_init_keyhash() */
+#define EMSC_KEYHASH_SIZE (64)
+static int emsc_keyhash[EMSC_KEYHASH_SIZE];
+
+static uint32_t emsc_hash_str(const char* str) {
+    uint32_t h = 0x811C9DC5;
+    while (*str) {
+        h = (h ^ (uint8_t)*str++) * 0x01000193;
+    }
+    return h;
+}
+
+static void emsc_init_keyhash(void) {
+    for (int i = 0; i < EMSC_KEYHASH_SIZE; i++) {
+        emsc_keyhash[i] = -1;
+    }
+    for (int i = 0; emsc_keymap[i].str; i++) {
+        uint32_t slot = emsc_hash_str(emsc_keymap[i].str) % EMSC_KEYHASH_SIZE;
+        while (emsc_keyhash[slot] >= 0) {
+            slot = (slot + 1) % EMSC_KEYHASH_SIZE;
+        }
+        emsc_keyhash[slot] = i;
+    }
+}
+
 static wgpu_keycode_t emsc_translate_key(const char* str) {
-    int i = 0;
-    const char* keystr;
-    while (( keystr = emsc_keymap[i].str )) {
-        if (0 == strcmp(str, keystr)) {
+    uint32_t slot = emsc_hash_str(str) % EMSC_KEYHASH_SIZE;
+    while (emsc_keyhash[slot] >= 0) {
+        const int i = emsc_keyhash[slot];
+        if (0 == strcmp(str, emsc_keymap[i].str)) {
             return emsc_keymap[i].code;
         }
-        i += 1;
+        slot = (slot + 1) % EMSC_KEYHASH_SIZE;
     }
     return WGPU_KEY_INVALID;
 }
@@ -60,8 +117,8 @@ static EM_BOOL emsc_keydown_cb(int type, const EmscriptenKeyboardEvent* ev, void
     (void)type;
     wgpu_state_t* state = (wgpu_state_t*)userdata;
     wgpu_keycode_t wgpu_key = emsc_translate_key(ev->code);
-    if ((WGPU_KEY_INVALID != wgpu_key) && (state->key_down_cb)) {
-        state->key_down_cb((int)wgpu_key);
+    if (WGPU_KEY_INVALID != wgpu_key) {
+        wgpu_push_event(state, &(wgpu_event_t){ .type = WGPU_EVENTTYPE_KEY_DOWN, .key = wgpu_key });
     }
     return EM_TRUE;
 }
@@ -70,8 +127,8 @@ static EM_BOOL emsc_keyup_cb(int type, const EmscriptenKeyboardEvent* ev, void*
     (void)type;
     wgpu_state_t* state = (wgpu_state_t*)userdata;
     wgpu_keycode_t wgpu_key = emsc_translate_key(ev->code);
-    if ((WGPU_KEY_INVALID != wgpu_key) && (state->key_up_cb)) {
-        state->key_up_cb((int)wgpu_key);
+    if (WGPU_KEY_INVALID != wgpu_key) {
+        wgpu_push_event(state, &(wgpu_event_t){ .type = WGPU_EVENTTYPE_KEY_UP, .key = wgpu_key });
     }
     return EM_TRUE;
 }
@@ -79,17 +136,15 @@ static EM_BOOL emsc_keyup_cb(int type, const EmscriptenKeyboardEvent* ev, void*
 static EM_BOOL emsc_keypress_cb(int type, const EmscriptenKeyboardEvent* ev, void* userdata) {
     (void)type;
     wgpu_state_t* state = (wgpu_state_t*)userdata;
-    if (state->char_cb) {
-        state->char_cb(ev->charCode);
-    }
+    wgpu_push_event(state, &(wgpu_event_t){ .type = WGPU_EVENTTYPE_CHAR, .char_code = ev->charCode });
     return EM_TRUE;
 }
 
 static EM_BOOL emsc_mousedown_cb(int type, const EmscriptenMouseEvent* ev, void* userdata) {
     (void)type;
     wgpu_state_t* state = (wgpu_state_t*)userdata;
-    if ((ev->button < 3) && (state->mouse_btn_down_cb)) {
-        state->mouse_btn_down_cb(ev->button);
+    if (ev->button < 3) {
+        wgpu_push_event(state, &(wgpu_event_t){ .type = WGPU_EVENTTYPE_MOUSE_DOWN, .mouse_button = ev->button });
     }
     return EM_TRUE;
 }
@@ -97,8 +152,8 @@ static EM_BOOL emsc_mousedown_cb(int type, const EmscriptenMouseEvent* ev, void*
 static EM_BOOL emsc_mouseup_cb(int type, const EmscriptenMouseEvent* ev, void* userdata) {
     (void)type;
     wgpu_state_t* state = (wgpu_state_t*)userdata;
-    if ((ev->button < 3) && (state->mouse_btn_up_cb)) {
-        state->mouse_btn_up_cb(ev->button);
+    if (ev->button < 3) {
+        wgpu_push_event(state, &(wgpu_event_t){ .type = WGPU_EVENTTYPE_MOUSE_UP, .mouse_button = ev->button });
     }
     return EM_TRUE;
 }
@@ -106,39 +161,34 @@ static EM_BOOL emsc_mouseup_cb(int type, const EmscriptenMouseEvent* ev, void* u
 static EM_BOOL emsc_mousemove_cb(int type, const EmscriptenMouseEvent* ev, void* userdata) {
     (void)type;
     wgpu_state_t* state = (wgpu_state_t*)userdata;
-    if (state->mouse_pos_cb) {
-        state->mouse_pos_cb((float) ev->targetX, (float)ev->targetY);
-    }
+    wgpu_push_event(state, &(wgpu_event_t){
+        .type = WGPU_EVENTTYPE_MOUSE_MOVE,
+        // CSS pixels to framebuffer pixels
+        .mouse_x = (float) ev->targetX * state->dpi_scale,
+        .mouse_y = (float) ev->targetY * state->dpi_scale,
+    });
     return EM_TRUE;
 }
 
 static EM_BOOL emsc_wheel_cb(int type, const EmscriptenWheelEvent* ev, void* userdata) {
     (void)type;
     wgpu_state_t* state = (wgpu_state_t*)userdata;
-    if (state->mouse_wheel_cb) {
-        state->mouse_wheel_cb(-0.1f * (float)ev->deltaY);
-    }
+    wgpu_push_event(state, &(wgpu_event_t){ .type = WGPU_EVENTTYPE_MOUSE_WHEEL, .wheel = -0.1f * (float)ev->deltaY });
     return EM_TRUE;
 }
 
-static void error_cb(WGPUErrorType type, const char* message, void* userdata) {
-    (void)type; (void)userdata;
-    if (type != WGPUErrorType_NoError) {
-        printf("ERROR: %s\n", message);
-    }
-}
-
 static void request_device_cb(WGPURequestDeviceStatus status, WGPUDevice device, const char* msg, void* userdata) {
     (void)status; (void)msg; (void)userdata;
     wgpu_state_t* state = userdata;
     if (status != WGPURequestDeviceStatus_Success) {
-        printf("wgpuAdapterRequestDevice failed with %s!\n", msg);
+        fprintf(stderr, "wgpuAdapterRequestDevice failed with %s!\n", msg);
         state->async_setup_failed = true;
         return;
     }
     state->device = device;
 
-    wgpuDeviceSetUncapturedErrorCallback(state->device, error_cb, 0);
+    wgpuDeviceSetUncapturedErrorCallback(state->device, wgpu_uncaptured_error_cb, state);
+    // setup always runs validated
     wgpuDevicePushErrorScope(state->device, WGPUErrorFilter_Validation);
 
     // setup swapchain
@@ -151,14 +201,14 @@ static void request_device_cb(WGPURequestDeviceStatus status, WGPUDevice device,
     };
     state->surface = wgpuInstanceCreateSurface(state->instance, &surf_desc);
     if (!state->surface) {
-        printf("wgpuInstanceCreateSurface() failed.\n");
+        fprintf(stderr, "wgpuInstanceCreateSurface() failed.\n");
         state->async_setup_failed = true;
         return;
     }
     state->render_format = wgpuSurfaceGetPreferredFormat(state->surface, state->adapter);
     wgpu_swapchain_init(state);
     state->desc.init_cb();
-    wgpuDevicePopErrorScope(state->device, error_cb, 0);
+    wgpuDevicePopErrorScope(state->device, wgpu_error_cb, state);
     state->async_setup_done = true;
 }
 
@@ -166,7 +216,7 @@ static void request_adapter_cb(WGPURequestAdapterStatus status, WGPUAdapter adap
     (void)msg;
     wgpu_state_t* state = userdata;
     if (status != WGPURequestAdapterStatus_Success) {
-        printf("wgpuInstanceRequestAdapter failed!\n");
+        fprintf(stderr, "wgpuInstanceRequestAdapter failed!\n");
         state->async_setup_failed = true;
     }
     state->adapter = adapter;
@@ -182,7 +232,6 @@ static void request_adapter_cb(WGPURequestAdapterStatus status, WGPUAdapter adap
 }
 
 static EM_BOOL emsc_frame(double time, void* userdata) {
-    (void)time;
     wgpu_state_t* state = userdata;
     if (state->async_setup_failed) {
         return EM_FALSE;
@@ -190,20 +239,45 @@ static EM_BOOL emsc_frame(double time, void* userdata) {
     if (!state->async_setup_done) {
         return EM_TRUE;
     }
-    wgpuDevicePushErrorScope(state->device, WGPUErrorFilter_Validation);
-    state->swapchain_view = wgpuSwapChainGetCurrentTextureView(state->swapchain);
+    if (state->finishing) {
+        // the last frame ran, wait for the outstanding capture readbacks
+        if (!wgpu_capture_finished(state)) {
+            return EM_TRUE;
+        }
+        wgpu_capture_report(state);
+        state->desc.shutdown_cb();
+        return EM_FALSE;
+    }
+    if (!wgpu_capture_ready(state) || !wgpu_pacer_tick(state, time)) {
+        return EM_TRUE;
+    }
+    wgpu_validation_begin(state);
+    if (state->resize_pending) {
+        emsc_apply_resize(state);
+    }
+    const double frame_start = emscripten_get_now();
     state->desc.frame_cb();
-    wgpuTextureViewRelease(state->swapchain_view);
-    state->swapchain_view = 0;
-    wgpuDevicePopErrorScope(state->device, error_cb, 0);
+    wgpu_capture_frame(state, emscripten_get_now() - frame_start);
+    if (state->swapchain_view) {
+        wgpuTextureViewRelease(state->swapchain_view);
+        state->swapchain_view = 0;
+    }
+    wgpu_validation_end(state);
+    if (!wgpu_frame_done(state)) {
+        state->finishing = true;
+    }
     return EM_TRUE;
 }
 
 void wgpu_platform_start(wgpu_state_t* state) {
     assert(state->instance == 0);
 
+    emsc_init_keyhash();
     emsc_update_canvas_size(state);
-    emscripten_set_resize_callback("#canvas", 0, false, emsc_size_changed);
+    if (!state->desc.capture.enabled) {
+        // capture mode keeps its initial size
+        emscripten_set_resize_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, state, false, emsc_size_changed);
+    }
     emscripten_set_keydown_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, state, true, emsc_keydown_cb);
     emscripten_set_keyup_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, state, true, emsc_keyup_cb);
     emscripten_set_keypress_callback(EMSCRIPTEN_EVENT_TARGET_WINDOW, state, true, emsc_keypress_cb);
@@ -215,6 +289,11 @@ void wgpu_platform_start(wgpu_state_t* state) {
     state->instance = wgpuCreateInstance(0);
     assert(state->instance);
     wgpuInstanceRequestAdapter(state->instance, 0, request_adapter_cb, state);
+    // the browser acquires adapter and device in the background, the CPU
+    // side of the startup overlaps with it
+    if (state->desc.preinit_cb) {
+        state->desc.preinit_cb();
+    }
 
     emscripten_request_animation_frame_loop(emsc_frame, state);
 }
@@ -0,0 +1,49 @@
+//------------------------------------------------------------------------------
+//  wgpu_entry_null.c
+//
+//  Null platform: no window, no input and no WebGPU device. sokol-gfx runs
+//  with its dummy backend, so the whole frame loop (UI, culling, uploads,
+//  draw call submission) is executed on the CPU only, e.g. for profiling
+//  frame() with perf or for frame benchmarks on machines without a GPU.
+//------------------------------------------------------------------------------
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <assert.h>
+#include <time.h>
+#include "wgpu_entry.h"
+
+#if !defined(SOKOL_DUMMY_BACKEND)
+#error "wgpu_entry_null.c requires sokol-gfx to be compiled with SOKOL_DUMMY_BACKEND"
+#endif
+
+static double null_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+void wgpu_platform_start(wgpu_state_t* state) {
+    assert(!state->async_setup_done);
+    if (state->desc.preinit_cb) {
+        state->desc.preinit_cb();
+    }
+    state->async_setup_done = true;
+    state->desc.init_cb();
+
+    // without vsync frames run back to back unless desc.max_fps is set
+    const struct timespec idle = { .tv_sec = 0, .tv_nsec = 250000 };
+    bool running = true;
+    while (running) {
+        if (!wgpu_pacer_tick(state, null_now_ms())) {
+            nanosleep(&idle, 0);
+            continue;
+        }
+        const double frame_start = null_now_ms();
+        state->desc.frame_cb();
+        wgpu_capture_frame(state, null_now_ms() - frame_start);
+        running = wgpu_frame_done(state);
+    }
+    wgpu_capture_report(state);
+    state->desc.shutdown_cb();
+    fprintf(stderr, "null platform: %d frames\n", state->frame_count);
+}
@@ -6,25 +6,37 @@
 #include "wgpu_entry.h"
 #include <assert.h>
 
-void wgpu_swapchain_init(wgpu_state_t* state) {
-    assert(state->adapter);
-    assert(state->device);
-    assert(state->surface);
-    assert(state->render_format != WGPUTextureFormat_Undefined);
-    assert(0 == state->swapchain);
-    assert(0 == state->depth_stencil_tex);
-    assert(0 == state->depth_stencil_view);
-    assert(0 == state->msaa_tex);
-    assert(0 == state->msaa_view);
+static void wgpu_attachments_discard(wgpu_state_t* state) {
+    if (state->msaa_view) {
+        wgpuTextureViewRelease(state->msaa_view);
+        state->msaa_view = 0;
+    }
+    if (state->msaa_tex) {
+        wgpuTextureRelease(state->msaa_tex);
+        state->msaa_tex = 0;
+    }
+    if (state->depth_stencil_view) {
+        wgpuTextureViewRelease(state->depth_stencil_view);
+        state->depth_stencil_view = 0;
+    }
+    if (state->depth_stencil_tex) {
+        wgpuTextureRelease(state->depth_stencil_tex);
+        state->depth_stencil_tex = 0;
+    }
+    state->attachments_width = 0;
+    state->attachments_height = 0;
+    state->attachments_sample_count = 0;
+}
 
-    state->swapchain = wgpuDeviceCreateSwapChain(state->device, state->surface, &(WGPUSwapChainDescriptor){
-        .usage = WGPUTextureUsage_RenderAttachment,
-        .format = state->render_format,
-        .width = (uint32_t)state->width,
-        .height = (uint32_t)state->height,
-        .presentMode = WGPUPresentMode_Fifo,
-    });
-    assert(state->swapchain);
+/* depth-stencil and MSAA textures, only recreated if their size or sample count is stale */
+static void wgpu_attachments_init(wgpu_state_t* state) {
+    if ((state->attachments_width == state->width) &&
+        (state->attachments_height == state->height) &&
+        (state->attachments_sample_count == state->desc.sample_count))
+    {
+        return;
+    }
+    wgpu_attachments_discard(state);
 
     if (!state->desc.no_depth_buffer) {
         state->depth_stencil_tex = wgpuDeviceCreateTexture(state->device, &(WGPUTextureDescriptor){
@@ -61,27 +73,69 @@ void wgpu_swapchain_init(wgpu_state_t* state) {
         state->msaa_view = wgpuTextureCreateView(state->msaa_tex, 0);
         assert(state->msaa_view);
     }
+    state->attachments_width = state->width;
+    state->attachments_height = state->height;
+    state->attachments_sample_count = state->desc.sample_count;
 }
 
-void wgpu_swapchain_discard(wgpu_state_t* state) {
-    if (state->msaa_view) {
-        wgpuTextureViewRelease(state->msaa_view);
-        state->msaa_view = 0;
+static WGPUPresentMode wgpu_present_mode(wgpu_present_mode_t mode) {
+    switch (mode) {
+        case WGPU_PRESENTMODE_MAILBOX:      return WGPUPresentMode_Mailbox;
+        case WGPU_PRESENTMODE_IMMEDIATE:    return WGPUPresentMode_Immediate;
+        default:                            return WGPUPresentMode_Fifo;
     }
-    if (state->msaa_tex) {
-        wgpuTextureRelease(state->msaa_tex);
-        state->msaa_tex = 0;
+}
+
+void wgpu_swapchain_init(wgpu_state_t* state) {
+    assert(state->adapter);
+    assert(state->device);
+    assert(state->surface);
+    assert(state->render_format != WGPUTextureFormat_Undefined);
+    assert(0 == state->swapchain);
+    assert(0 == state->swapchain_view);
+
+    if (state->desc.capture.enabled) {
+        // capture mode renders into an offscreen texture instead
+        wgpu_capture_init_target(state);
+        wgpu_attachments_init(state);
+        return;
     }
-    if (state->depth_stencil_view) {
-        wgpuTextureViewRelease(state->depth_stencil_view);
-        state->depth_stencil_view = 0;
+    state->swapchain = wgpuDeviceCreateSwapChain(state->device, state->surface, &(WGPUSwapChainDescriptor){
+        .usage = WGPUTextureUsage_RenderAttachment,
+        .format = state->render_format,
+        .width = (uint32_t)state->width,
+        .height = (uint32_t)state->height,
+        .presentMode = wgpu_present_mode(state->desc.present_mode),
+    });
+    assert(state->swapchain);
+    wgpu_attachments_init(state);
+}
+
+void wgpu_swapchain_discard(wgpu_state_t* state) {
+    wgpu_attachments_discard(state);
+    wgpu_capture_discard(state);
+    if (state->swapchain) {
+        wgpuSwapChainRelease(state->swapchain);
+        state->swapchain = 0;
     }
-    if (state->depth_stencil_tex) {
-        wgpuTextureRelease(state->depth_stencil_tex);
-        state->depth_stencil_tex = 0;
+}
+
+/*
+    Switch to a new surface size. Must be called between frames (no swapchain
+    view acquired). Only the swapchain itself is always recreated, the
+    depth-stencil and MSAA textures survive if their size didn't change.
+*/
+void wgpu_swapchain_resize(wgpu_state_t* state, int width, int height) {
+    assert((width > 0) && (height > 0));
+    assert(0 == state->swapchain_view);
+    if ((width == state->width) && (height == state->height) && state->swapchain) {
+        return;
     }
+    state->width = width;
+    state->height = height;
     if (state->swapchain) {
         wgpuSwapChainRelease(state->swapchain);
         state->swapchain = 0;
     }
+    wgpu_swapchain_init(state);
 }
@@ -0,0 +1,102 @@
+//------------------------------------------------------------------------------
+//  arena_test.cpp
+//
+//  Arena block merging, high-water marks and the per-thread frame arenas.
+//------------------------------------------------------------------------------
+#include "arena.hpp"
+
+#include <cstdint>
+
+#include "parallel.hpp"
+#include "test.hpp"
+
+using namespace simly;
+
+TEST_CASE(arena_merges_blocks_on_reset) {
+    Arena arena(1024);
+    uint8_t *a = static_cast<uint8_t *>(arena.allocate(1000, 1));
+    uint8_t *b = static_cast<uint8_t *>(arena.allocate(1000, 1));
+    uint8_t *c = static_cast<uint8_t *>(arena.allocate(1000, 1));
+    // three blocks, none of the allocations fit behind another
+    CHECK(arena.capacity() == 3 * 1024);
+    CHECK(arena.used() == 2 * 1024 + 1000);
+    CHECK((b != a + 1000) && (c != b + 1000));
+
+    arena.reset();
+    CHECK(arena.used() == 0);
+    CHECK(arena.capacity() == 3 * 1024);
+    // one merged block now, the same cycle runs contiguously without growing
+    a = static_cast<uint8_t *>(arena.allocate(1000, 1));
+    b = static_cast<uint8_t *>(arena.allocate(1000, 1));
+    c = static_cast<uint8_t *>(arena.allocate(1000, 1));
+    CHECK((b == a + 1000) && (c == b + 1000));
+    CHECK(arena.used() == 3000);
+    CHECK(arena.capacity() == 3 * 1024);
+}
+
+TEST_CASE(arena_aligns_allocations) {
+    Arena arena(256);
+    arena.allocate(1, 1);
+    void *p = arena.allocate(8, 64);
+    CHECK((reinterpret_cast<uintptr_t>(p) % 64) == 0);
+    double *d = arena.allocate_array<double>(3);
+    CHECK((reinterpret_cast<uintptr_t>(d) % alignof(double)) == 0);
+    // larger than the block size gets a block of its own
+    void *big = arena.allocate(4096, 16);
+    CHECK(big != nullptr);
+    CHECK(arena.capacity() >= 4096 + 256);
+}
+
+TEST_CASE(arena_high_water_across_resets) {
+    Arena arena(1024);
+    arena.allocate(500, 1);
+    CHECK(arena.get_high_water() == 500);
+    arena.reset();
+    arena.allocate(100, 1);
+    // the peak of the earlier cycle is kept
+    CHECK(arena.used() == 100);
+    CHECK(arena.get_high_water() == 500);
+    arena.reset_high_water();
+    CHECK(arena.get_high_water() == 100);
+    arena.allocate(2000, 1);
+    CHECK(arena.get_high_water() == arena.used());
+    CHECK(arena.get_high_water() > 2000);
+}
+
+TEST_CASE(arena_vector_grows) {
+    Arena arena(256);
+    ArenaVector<int> v{ArenaAllocator<int>(arena)};
+    for (int i = 0; i < 1000; i++)
+        v.push_back(i * 3);
+    bool same = v.size() == 1000;
+    for (int i = 0; same && (i < 1000); i++)
+        same = v[size_t(i)] == i * 3;
+    CHECK(same);
+    // outgrown buffers are only released by reset()
+    CHECK(arena.used() >= 1000 * sizeof(int));
+    CHECK(arena.capacity() >= arena.used());
+
+    ArenaVector<int> copy = v;
+    CHECK(copy == v);
+    CHECK(copy.get_allocator() == v.get_allocator());
+}
+
+TEST_CASE(frame_arena_per_thread_high_water) {
+    ThreadPool pool(4);
+    FrameArena::reset_all();
+    pool.run([](unsigned worker) {
+        Arena &arena = FrameArena::current();
+        arena.reset_high_water();
+        arena.allocate_array<uint8_t>(size_t(worker + 1) * 10000);
+    });
+    // every pool thread has its own arena
+    CHECK(FrameArena::high_water_max() == 4 * 10000);
+    CHECK(FrameArena::high_water_total() == (1 + 2 + 3 + 4) * 10000);
+
+    FrameArena::reset_all();
+    CHECK(FrameArena::current().used() == 0);
+    ArenaVector<float> v = make_frame_vector<float>(64);
+    CHECK(v.capacity() >= 64);
+    CHECK(FrameArena::current().used() >= 64 * sizeof(float));
+    FrameArena::reset_all();
+}
@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------------
+//  batch_test.cpp
+//
+//  ThreadPool worker indices and BatchRunner.
+//------------------------------------------------------------------------------
+#include "batch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "test.hpp"
+
+using namespace simly;
+
+TEST_CASE(pool_nested_calls_keep_worker_index) {
+    ThreadPool pool(4);
+    std::atomic<int> mismatches{0};
+    pool.parallel_for(64, 1, [&](size_t, size_t, unsigned worker) {
+        // inline fast path
+        pool.parallel_for(1, 1, [&](size_t, size_t, unsigned w) {
+            mismatches += (w != worker) ? 1 : 0;
+        });
+        // nested run
+        pool.run([&](unsigned w) { mismatches += (w != worker) ? 1 : 0; });
+        mismatches += (pool.current_worker() != worker) ? 1 : 0;
+    });
+    CHECK(mismatches == 0);
+    CHECK(pool.current_worker() == 0);
+}
+
+TEST_CASE(pool_worker_index_owned_by_one_thread) {
+    ThreadPool pool(4);
+    std::vector<std::atomic<size_t>> owner(pool.size());
+    for (std::atomic<size_t> &o : owner)
+        o = 0;
+    std::atomic<int> shared{0};
+    pool.parallel_for(256, 1, [&](size_t, size_t, unsigned worker) {
+        const size_t self =
+            std::hash<std::thread::id>()(std::this_thread::get_id());
+        size_t expected = 0;
+        if (!owner[worker].compare_exchange_strong(expected, self) &&
+            (expected != self))
+            shared++;
+    });
+    CHECK(shared == 0);
+}
+
+TEST_CASE(pool_calls_into_another_pool) {
+    ThreadPool outer(4);
+    ThreadPool inner(3);
+    std::vector<std::atomic<int>> active(inner.size());
+    for (std::atomic<int> &a : active)
+        a = 0;
+    std::atomic<int> overlaps{0};
+    std::atomic<int> bad_index{0};
+    std::atomic<int> calls{0};
+    outer.parallel_for(16, 1, [&](size_t, size_t, unsigned) {
+        // dispatched on the inner pool, not inline with a foreign index
+        inner.run([&](unsigned w) {
+            if (w >= inner.size()) {
+                bad_index++;
+                return;
+            }
+            overlaps += (active[w].fetch_add(1) != 0) ? 1 : 0;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            active[w]--;
+            calls++;
+        });
+    });
+    CHECK(bad_index == 0);
+    CHECK(overlaps == 0);
+    CHECK(calls == 16 * int(inner.size()));
+}
+
+namespace {
+
+struct Program {
+    int64_t scale = 1;
+};
+
+// sums scale * [0, n) in an arena buffer, with a nested parallel loop
+int64_t run_instance(const Program &program, const int &n, Arena &arena,
+                     ThreadPool &pool) {
+    int64_t *values = arena.allocate_array<int64_t>(size_t(n));
+    pool.parallel_for(size_t(n), 16, [&](size_t b, size_t e, unsigned) {
+        for (size_t i = b; i < e; i++)
+            values[i] = int64_t(i) * program.scale;
+    });
+    int64_t sum = 0;
+    for (int i = 0; i < n; i++)
+        sum += values[i];
+    return sum;
+}
+
+} // namespace
+
+TEST_CASE(batch_results_in_config_order) {
+    ThreadPool pool(4);
+    auto program = std::make_shared<const Program>(Program{3});
+    BatchRunner<Program, int, int64_t> runner(program, pool, 1024);
+    std::vector<int> configs;
+    for (int i = 0; i < 200; i++)
+        configs.push_back((i * 37) % 500);
+    std::vector<int64_t> results = runner.run(
+        configs, [&](const Program &p, const int &n, Arena &arena) {
+            return run_instance(p, n, arena, pool);
+        });
+    CHECK(results.size() == configs.size());
+    for (size_t i = 0; i < configs.size(); i++) {
+        const int64_t n = configs[i];
+        CHECK(results[i] == 3 * n * (n - 1) / 2);
+    }
+    CHECK(runner.peak_arena_capacity() >= 499 * sizeof(int64_t));
+    CHECK(&runner.get_program() == program.get());
+}
+
+TEST_CASE(batch_empty_sweep) {
+    ThreadPool pool(2);
+    BatchRunner<Program, int, int64_t> runner(
+        std::make_shared<const Program>(), pool);
+    std::vector<int64_t> results = runner.run(
+        {}, [](const Program &, const int &, Arena &) { return int64_t(1); });
+    CHECK(results.empty());
+}
@@ -0,0 +1,135 @@
+//------------------------------------------------------------------------------
+//  derived_test.cpp
+//
+//  DerivedGraph laziness and parsing of `derived` declarations.
+//------------------------------------------------------------------------------
+#include "derived.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "dsl.hpp"
+#include "test.hpp"
+
+using namespace simly;
+
+TEST_CASE(derived_computes_on_demand) {
+    DerivedGraph graph;
+    float mass              = 2.0f;
+    float speed             = 3.0f;
+    const QuantityId m      = graph.add_input("mass");
+    const QuantityId v      = graph.add_input("speed");
+    Derived<float> momentum(graph, "momentum", {m, v},
+                            [&](float &p) { p = mass * speed; });
+    Derived<float> energy(graph, "energy", {momentum.get_id(), v},
+                          [&](float &e) { e = 0.5f * momentum.get() * speed; });
+
+    // nothing runs until a value is read
+    CHECK(graph.compute_count(momentum.get_id()) == 0);
+    CHECK(graph.is_dirty(energy.get_id()));
+    CHECK(energy.get() == 9.0f);
+    CHECK(graph.compute_count(momentum.get_id()) == 1);
+    CHECK(graph.compute_count(energy.get_id()) == 1);
+
+    // clean reads don't recompute
+    CHECK(energy.get() == 9.0f);
+    CHECK(graph.compute_count(energy.get_id()) == 1);
+
+    // an input change dirties the whole downstream chain
+    mass = 4.0f;
+    graph.invalidate(m);
+    CHECK(graph.is_dirty(momentum.get_id()));
+    CHECK(graph.is_dirty(energy.get_id()));
+    CHECK(!graph.is_dirty(v));
+    CHECK(momentum.get() == 12.0f);
+    CHECK(graph.compute_count(energy.get_id()) == 1);
+    CHECK(energy.get() == 18.0f);
+    CHECK(graph.compute_count(momentum.get_id()) == 2);
+    CHECK(graph.compute_count(energy.get_id()) == 2);
+
+    CHECK(graph.find("energy") == energy.get_id());
+    CHECK(graph.find("power") == InvalidQuantity);
+    CHECK(graph.name(m) == "mass");
+    CHECK(graph.size() == 4);
+}
+
+TEST_CASE(derived_binds_parsed_declaration) {
+    DerivedGraph graph;
+    graph.add_input("x");
+    graph.add_input("y");
+
+    dsl::TokenStream ts("derived dist(x, y) sqrt(x * x + y * y);");
+    dsl::DerivedDecl decl;
+    CHECK(dsl::parse_derived_decl(ts, decl));
+    int computed        = 0;
+    const QuantityId id = graph.add_derived(decl, [&] { computed++; });
+    CHECK(id != InvalidQuantity);
+    CHECK(graph.name(id) == "dist");
+    graph.require(id);
+    CHECK(computed == 1);
+
+    dsl::TokenStream bad("derived d(x, z) x;");
+    CHECK(dsl::parse_derived_decl(bad, decl));
+    CHECK(graph.add_derived(decl, [] {}) == InvalidQuantity);
+    CHECK(graph.find("d") == InvalidQuantity);
+}
+
+TEST_CASE(derived_rejects_duplicate_names) {
+    DerivedGraph graph;
+    graph.add_input("x");
+    const size_t num_nodes = graph.size();
+
+    // a second declaration of a name, and a derived shadowing an input
+    dsl::TokenStream ts("derived d(x) x; derived d(x) x + 1; derived x() 0;");
+    dsl::DerivedDecl decl;
+    CHECK(dsl::parse_derived_decl(ts, decl));
+    const QuantityId first = graph.add_derived(decl, [] {});
+    CHECK(first != InvalidQuantity);
+    CHECK(dsl::parse_derived_decl(ts, decl));
+    CHECK(graph.add_derived(decl, [] {}) == InvalidQuantity);
+    CHECK(dsl::parse_derived_decl(ts, decl));
+    CHECK(graph.add_derived(decl, [] {}) == InvalidQuantity);
+
+    // the first definition is kept
+    CHECK(graph.find("d") == first);
+    CHECK(graph.size() == num_nodes + 1);
+}
+
+TEST_CASE(dsl_parses_derived_declarations) {
+    dsl::TokenStream ts("derived speed(vx, vy) vx * vx + vy * vy;\n"
+                        "derived zero() 0;");
+    dsl::DerivedDecl decl;
+    CHECK(dsl::parse_derived_decl(ts, decl));
+    CHECK(decl.name == "speed");
+    CHECK((decl.inputs.size() == 2) && (decl.inputs[0] == "vx") &&
+          (decl.inputs[1] == "vy"));
+    CHECK(decl.body.size() == 7);
+
+    CHECK(dsl::parse_derived_decl(ts, decl));
+    CHECK(decl.name == "zero");
+    CHECK(decl.inputs.empty());
+    CHECK(decl.body.size() == 1);
+    CHECK(ts.eof());
+}
+
+TEST_CASE(dsl_rejects_malformed_derived_declarations) {
+    const std::vector<std::string> sources = {
+        "derived a(x,) x;",  // trailing comma
+        "derived a(,x) x;",  // leading comma
+        "derived a(x y) x;", // missing comma
+        "derived a(x x;",    // unclosed input list
+        "derived a(x) x",    // missing ';'
+        "derived (x) x;",    // missing name
+        "derived a x;",      // missing input list
+        "a(x) x;",           // missing keyword
+    };
+    for (const std::string &source : sources) {
+        dsl::TokenStream ts(source);
+        dsl::DerivedDecl decl;
+        const bool parsed = dsl::parse_derived_decl(ts, decl);
+        CHECK(!parsed);
+        if (parsed)
+            fprintf(stderr, "accepted: %s\n", source.c_str());
+    }
+}
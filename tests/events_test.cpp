@@ -0,0 +1,127 @@
+//------------------------------------------------------------------------------
+//  events_test.cpp
+//
+//  EventQueue ordering and delivery.
+//------------------------------------------------------------------------------
+#include "events.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "test.hpp"
+
+using namespace simly;
+
+namespace {
+
+struct Hit {
+    uint32_t seq    = 0;
+    uint32_t amount = 0;
+};
+
+// every source sends a few events to pseudo-random targets, in parallel
+void push_events(EventQueue<Hit> &queue, ThreadPool &pool,
+                 uint32_t num_sources, uint32_t num_targets) {
+    pool.parallel_for(num_sources, 64, [&](size_t b, size_t e, unsigned w) {
+        for (size_t s = b; s < e; s++) {
+            for (uint32_t k = 0; k < 3; k++) {
+                const uint32_t target =
+                    uint32_t((s * 2654435761u + k * 40503u) % num_targets);
+                // equal (target, source) pairs keep their push order
+                queue.push(w, target, uint32_t(s), Hit{k, uint32_t(s + k)});
+                if (k == 1)
+                    queue.push(w, target, uint32_t(s), Hit{k + 10, 0});
+            }
+        }
+    });
+}
+
+} // namespace
+
+TEST_CASE(events_sorted_by_target_and_source) {
+    ThreadPool pool(4);
+    EventQueue<Hit> queue(pool);
+    const uint32_t num_sources = 40000;
+    push_events(queue, pool, num_sources, 5000);
+    CHECK(queue.flush() == num_sources * 4);
+
+    const std::vector<EventQueue<Hit>::Event> &sorted = queue.get_sorted();
+    CHECK(sorted.size() == num_sources * 4);
+    bool ordered = true;
+    for (size_t i = 1; i < sorted.size(); i++) {
+        const EventQueue<Hit>::Event &p = sorted[i - 1];
+        const EventQueue<Hit>::Event &c = sorted[i];
+        if ((p.target > c.target) ||
+            ((p.target == c.target) && (p.source > c.source)) ||
+            ((p.target == c.target) && (p.source == c.source) &&
+             (p.payload.seq > c.payload.seq)))
+            ordered = false;
+    }
+    CHECK(ordered);
+}
+
+TEST_CASE(events_same_order_for_any_pool_size) {
+    ThreadPool serial(1);
+    ThreadPool pool(4);
+    EventQueue<Hit> a(serial);
+    EventQueue<Hit> b(pool);
+    push_events(a, serial, 20000, 300);
+    push_events(b, pool, 20000, 300);
+    a.flush();
+    b.flush();
+    const std::vector<EventQueue<Hit>::Event> &ea = a.get_sorted();
+    const std::vector<EventQueue<Hit>::Event> &eb = b.get_sorted();
+    bool same = ea.size() == eb.size();
+    for (size_t i = 0; same && (i < ea.size()); i++)
+        same = (ea[i].target == eb[i].target) &&
+               (ea[i].source == eb[i].source) &&
+               (ea[i].payload.seq == eb[i].payload.seq);
+    CHECK(same);
+}
+
+TEST_CASE(events_deliver_groups_targets) {
+    ThreadPool pool(4);
+    EventQueue<Hit> queue(pool);
+    const uint32_t num_targets = 7000;
+    push_events(queue, pool, 30000, num_targets);
+    queue.flush();
+
+    std::vector<uint32_t> serial_sum(num_targets, 0);
+    std::vector<uint32_t> calls(num_targets, 0);
+    uint32_t last_target = 0;
+    bool ascending       = true;
+    bool first           = true;
+    queue.deliver([&](uint32_t target, const EventQueue<Hit>::Event *b,
+                      const EventQueue<Hit>::Event *e) {
+        ascending = ascending && (first || (target > last_target));
+        first     = false;
+        calls[target]++;
+        for (const EventQueue<Hit>::Event *ev = b; ev != e; ev++)
+            serial_sum[target] += ev->payload.amount;
+        last_target = target;
+    });
+    CHECK(ascending);
+
+    // one call per target, so handlers may write their target unlocked
+    std::vector<uint32_t> parallel_sum(num_targets, 0);
+    std::vector<std::atomic<uint32_t>> parallel_calls(num_targets);
+    for (std::atomic<uint32_t> &c : parallel_calls)
+        c = 0;
+    queue.deliver_parallel([&](uint32_t target,
+                               const EventQueue<Hit>::Event *b,
+                               const EventQueue<Hit>::Event *e) {
+        parallel_calls[target]++;
+        for (const EventQueue<Hit>::Event *ev = b; ev != e; ev++)
+            parallel_sum[target] += ev->payload.amount;
+    });
+    bool same = true;
+    for (uint32_t t = 0; t < num_targets; t++)
+        same = same && (calls[t] <= 1) && (parallel_calls[t] == calls[t]) &&
+               (parallel_sum[t] == serial_sum[t]);
+    CHECK(same);
+
+    queue.clear();
+    CHECK(queue.get_sorted().empty());
+    CHECK(queue.flush() == 0);
+}
@@ -0,0 +1,191 @@
+//------------------------------------------------------------------------------
+//  reduce_test.cpp
+//
+//  Reductions, scans and compaction against serial reference loops.
+//------------------------------------------------------------------------------
+#include "reduce.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "test.hpp"
+
+using namespace simly;
+
+namespace {
+
+// 2x2 matrices with wrapping integer entries, their product is associative
+// but not commutative
+struct Mat2 {
+    uint32_t a = 1, b = 0, c = 0, d = 1;
+
+    bool operator==(const Mat2 &o) const {
+        return (a == o.a) && (b == o.b) && (c == o.c) && (d == o.d);
+    }
+};
+
+Mat2 mul(const Mat2 &x, const Mat2 &y) {
+    Mat2 r;
+    r.a = x.a * y.a + x.b * y.c;
+    r.b = x.a * y.b + x.b * y.d;
+    r.c = x.c * y.a + x.d * y.c;
+    r.d = x.c * y.b + x.d * y.d;
+    return r;
+}
+
+std::vector<Mat2> make_matrices(size_t n) {
+    std::vector<Mat2> m(n);
+    for (size_t i = 0; i < n; i++) {
+        const uint32_t k = uint32_t(i % 7) + 1;
+        m[i] = (i % 3 == 0) ? Mat2{1, k, 0, 1} : Mat2{1, 0, k, 1};
+    }
+    return m;
+}
+
+// empty, single element, below one lane round, not a multiple of the lane
+// count, below one chunk, exactly one chunk and several chunks with a tail
+const size_t Sizes[] = {0,
+                        1,
+                        ReduceLanes - 1,
+                        ReduceLanes * 3 + 5,
+                        1000,
+                        ReduceChunk,
+                        ReduceChunk * 3 + 7};
+
+// leaves garbage in the arena, so unwritten scratch shows up
+void dirty_frame_arena() {
+    FrameArena::reset_all();
+    uint8_t *junk = FrameArena::current().allocate_array<uint8_t>(4096);
+    std::memset(junk, 0xBE, 4096);
+    FrameArena::reset_all();
+}
+
+} // namespace
+
+TEST_CASE(reduce_keeps_element_order) {
+    ThreadPool pool(4);
+    for (size_t n : Sizes) {
+        const std::vector<Mat2> m = make_matrices(n);
+        Mat2 expected;
+        for (const Mat2 &x : m)
+            expected = mul(expected, x);
+        const Mat2 result = reduce(m.data(), n, Mat2(), mul, pool);
+        CHECK(result == expected);
+    }
+    FrameArena::reset_all();
+}
+
+TEST_CASE(reduce_sum_min_max) {
+    ThreadPool pool(4);
+    for (size_t n : Sizes) {
+        std::vector<int64_t> v(n);
+        int64_t sum = 0;
+        int64_t lo  = INT64_MAX;
+        int64_t hi  = INT64_MIN;
+        for (size_t i = 0; i < n; i++) {
+            v[i] = int64_t((i * 7919) % 1013) - 500;
+            sum += v[i];
+            lo = std::min(lo, v[i]);
+            hi = std::max(hi, v[i]);
+        }
+        CHECK(reduce_sum(v.data(), n, pool) == sum);
+        CHECK(reduce_min(v.data(), n, pool) == lo);
+        CHECK(reduce_max(v.data(), n, pool) == hi);
+    }
+    FrameArena::reset_all();
+}
+
+TEST_CASE(reduce_float_independent_of_pool_size) {
+    ThreadPool serial(1);
+    ThreadPool pool(4);
+    const size_t n = ReduceChunk * 5 + 3;
+    std::vector<float> v(n);
+    for (size_t i = 0; i < n; i++)
+        v[i] = 1.0f / float(i + 1);
+    const float a = reduce_sum(v.data(), n, serial);
+    const float b = reduce_sum(v.data(), n, pool);
+    CHECK(std::memcmp(&a, &b, sizeof(float)) == 0);
+    FrameArena::reset_all();
+}
+
+TEST_CASE(exclusive_scan_sizes) {
+    ThreadPool pool(4);
+    for (size_t n : Sizes) {
+        std::vector<uint32_t> in(n);
+        std::vector<uint32_t> expected(n);
+        uint32_t total = 0;
+        for (size_t i = 0; i < n; i++) {
+            in[i]       = uint32_t(i % 5);
+            expected[i] = total;
+            total += in[i];
+        }
+        dirty_frame_arena();
+        std::vector<uint32_t> out(n, 0xFFFFFFFFu);
+        CHECK(exclusive_scan(in.data(), out.data(), n, pool) == total);
+        CHECK(out == expected);
+
+        // in place
+        dirty_frame_arena();
+        CHECK(exclusive_scan(in.data(), in.data(), n, pool) == total);
+        CHECK(in == expected);
+    }
+    FrameArena::reset_all();
+}
+
+TEST_CASE(count_and_compact_sizes) {
+    ThreadPool pool(4);
+    for (size_t n : Sizes) {
+        std::vector<float> values(n);
+        std::vector<uint8_t> keep(n);
+        std::vector<float> kept;
+        std::vector<uint32_t> kept_indices;
+        for (size_t i = 0; i < n; i++) {
+            values[i] = float(i);
+            keep[i]   = ((i * 31) % 11) < 4;
+            if (keep[i]) {
+                kept.push_back(values[i]);
+                kept_indices.push_back(uint32_t(i));
+            }
+        }
+        auto is_kept = [](uint8_t k) { return k != 0; };
+        dirty_frame_arena();
+        CHECK(count_if(keep.data(), n, is_kept, pool) == kept.size());
+
+        std::vector<float> out(n);
+        dirty_frame_arena();
+        const size_t num = compact(values.data(), keep.data(), n, out.data(),
+                                   pool);
+        out.resize(num);
+        CHECK(out == kept);
+
+        std::vector<uint32_t> indices(n);
+        dirty_frame_arena();
+        const size_t num_indices =
+            compact_indices(keep.data(), n, indices.data(), pool);
+        indices.resize(num_indices);
+        CHECK(indices == kept_indices);
+    }
+    FrameArena::reset_all();
+}
+
+TEST_CASE(histogram_clamps_and_drops_nan) {
+    ThreadPool pool(4);
+    const size_t n = ReduceChunk * 2 + 9;
+    std::vector<float> v(n);
+    for (size_t i = 0; i < n; i++)
+        v[i] = float(i % 10);
+    v[0] = -5.0f;
+    v[1] = 100.0f;
+    v[2] = std::numeric_limits<float>::quiet_NaN();
+    uint32_t bins[5];
+    histogram(v.data(), n, 0.0f, 10.0f, bins, 5, pool);
+    uint32_t expected[5] = {};
+    for (size_t i = 3; i < n; i++)
+        expected[size_t(v[i]) / 2]++;
+    expected[0]++;
+    expected[4]++;
+    CHECK(std::memcmp(bins, expected, sizeof(bins)) == 0);
+    FrameArena::reset_all();
+}
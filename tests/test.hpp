@@ -0,0 +1,58 @@
+#ifndef __TEST_HPP__
+#define __TEST_HPP__
+
+#include <cstdio>
+
+namespace simly {
+namespace test {
+
+// Minimal self-registering test cases. A failed CHECK is reported and
+// counted, the case keeps running.
+struct Case {
+    const char *name = {};
+    void (*fn)()     = {};
+    Case *next       = {};
+};
+
+inline Case *&first_case() {
+    static Case *first = nullptr;
+    return first;
+}
+
+inline int &num_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+struct Register {
+    Case c;
+
+    Register(const char *name, void (*fn)()) {
+        c.name = name;
+        c.fn   = fn;
+        // keep registration order, so cases run in file order
+        Case **tail = &first_case();
+        while (*tail)
+            tail = &(*tail)->next;
+        *tail = &c;
+    }
+};
+
+inline void check(bool ok, const char *expr, const char *file, int line) {
+    if (!ok) {
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expr);
+        num_failures()++;
+    }
+}
+
+} // namespace test
+} // namespace simly
+
+#define TEST_CASE(name)                                                        \
+    static void name();                                                        \
+    static simly::test::Register name##_register(#name, name);                 \
+    static void name()
+
+#define CHECK(cond) simly::test::check(bool(cond), #cond, __FILE__, __LINE__)
+
+#endif // __TEST_HPP__
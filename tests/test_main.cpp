@@ -0,0 +1,29 @@
+//------------------------------------------------------------------------------
+//  test_main.cpp
+//
+//  Runs all registered test cases, or the ones whose name contains the
+//  first argument.
+//------------------------------------------------------------------------------
+#include "test.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+int main(int argc, char **argv) {
+    const char *filter = (argc > 1) ? argv[1] : nullptr;
+    int num_cases      = 0;
+    int failed_cases   = 0;
+    for (simly::test::Case *c = simly::test::first_case(); c; c = c->next) {
+        if (filter && !strstr(c->name, filter)) {
+            continue;
+        }
+        const int failures_before = simly::test::num_failures();
+        c->fn();
+        const bool ok = simly::test::num_failures() == failures_before;
+        printf("%s %s\n", ok ? "ok  " : "FAIL", c->name);
+        num_cases++;
+        failed_cases += ok ? 0 : 1;
+    }
+    printf("%d of %d cases passed\n", num_cases - failed_cases, num_cases);
+    return (failed_cases == 0) ? 0 : 1;
+}